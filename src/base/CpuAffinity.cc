@@ -0,0 +1,104 @@
+#include "src/base/CpuAffinity.h"
+#include "src/logger/Logging.h"
+
+#include <fstream>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace mymuduo;
+
+namespace {
+// 读取/sys下只有一行内容的文件
+bool readLine(const std::string &path, std::string *line) {
+  std::ifstream in(path);
+  return static_cast<bool>(std::getline(in, *line));
+}
+} // namespace
+
+std::vector<int> CpuAffinity::parseCpuList(const std::string &list) {
+  std::vector<int> cpus;
+  const char *p = list.c_str();
+  while (*p != '\0') {
+    char *end;
+    long first = strtol(p, &end, 10);
+    if (end == p) {
+      break;
+    }
+    long last = first;
+    p = end;
+    if (*p == '-') {
+      last = strtol(p + 1, &end, 10);
+      p = end;
+    }
+    for (long cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(static_cast<int>(cpu));
+    }
+    if (*p == ',') {
+      ++p;
+    } else {
+      break;
+    }
+  }
+  return cpus;
+}
+
+std::vector<int> CpuAffinity::cpusOfNumaNode(int node) {
+  std::string line;
+  if (node < 0 ||
+      !readLine("/sys/devices/system/node/node" + std::to_string(node) +
+                    "/cpulist",
+                &line)) {
+    LOG_WARN << "CpuAffinity::cpusOfNumaNode() no such node " << node;
+    return std::vector<int>();
+  }
+  return parseCpuList(line);
+}
+
+int CpuAffinity::numaNodeOfInterface(const std::string &ifname) {
+  std::string line;
+  if (!readLine("/sys/class/net/" + ifname + "/device/numa_node", &line)) {
+    return -1;
+  }
+  return atoi(line.c_str());
+}
+
+bool CpuAffinity::bindCurrentThread(const std::vector<int> &cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  if (CPU_COUNT(&set) == 0) {
+    return false;
+  }
+  // pthread_setaffinity_np失败时返回错误码而不设置errno
+  int ret = ::pthread_setaffinity_np(::pthread_self(), sizeof set, &set);
+  if (ret != 0) {
+    errno = ret;
+    LOG_SYSERR << "CpuAffinity::bindCurrentThread()";
+    return false;
+  }
+  return true;
+}
+
+bool CpuAffinity::preferNumaNode(int node) {
+  const int kBitsPerWord = 8 * sizeof(unsigned long);
+  if (node < 0) {
+    return false;
+  }
+  std::vector<unsigned long> mask(node / kBitsPerWord + 1, 0);
+  mask[node / kBitsPerWord] |= 1UL << (node % kBitsPerWord);
+  // 内核只读取maxnode - 1位
+  unsigned long maxnode = mask.size() * kBitsPerWord + 1;
+  if (::syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask.data(), maxnode) < 0) {
+    LOG_SYSERR << "CpuAffinity::preferNumaNode()";
+    return false;
+  }
+  return true;
+}
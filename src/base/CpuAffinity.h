@@ -0,0 +1,31 @@
+#ifndef MYMUDUO_BASE_CPUAFFINITY_H
+#define MYMUDUO_BASE_CPUAFFINITY_H
+
+#include <string>
+#include <vector>
+
+namespace mymuduo {
+/**
+ * 线程的CPU亲和性与NUMA内存策略
+ * 信息都从/sys读取，内存策略直接调用set_mempolicy，不依赖libnuma。
+ * 失败时记录日志并返回false/空/-1，调用方可以忽略，不影响正确性。
+ */
+namespace CpuAffinity {
+// 解析"0-3,8,10-11"格式的CPU列表(/sys中cpulist的格式)
+std::vector<int> parseCpuList(const std::string &list);
+
+// NUMA节点node上的CPU，节点不存在时返回空
+std::vector<int> cpusOfNumaNode(int node);
+
+// 网卡ifname所在的NUMA节点，单节点机器或虚拟网卡返回-1
+int numaNodeOfInterface(const std::string &ifname);
+
+// 把调用线程绑定到cpus中的CPU上
+bool bindCurrentThread(const std::vector<int> &cpus);
+
+// 调用线程之后首次访问的内存页优先从node分配，node内存不足时回退到其他节点
+bool preferNumaNode(int node);
+} // namespace CpuAffinity
+} // namespace mymuduo
+
+#endif // MYMUDUO_BASE_CPUAFFINITY_H
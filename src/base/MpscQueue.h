@@ -0,0 +1,201 @@
+#ifndef MYMUDUO_BASE_MPSCQUEUE_H
+#define MYMUDUO_BASE_MPSCQUEUE_H
+
+#include "src/base/noncopyable.h"
+
+#include <atomic>
+#include <stddef.h>
+#include <utility>
+
+namespace mymuduo {
+
+/**
+ * 无锁的多生产者单消费者队列(Dmitry Vyukov的MPSC队列)
+ * push可以在任意线程调用，只需一次原子交换；pop/consume只能在唯一的消费者线程调用。
+ * 不是侵入式队列：节点不嵌在元素里，元素按值拷进队列自己分配的节点。
+ * 节点由消费者回收：每攒满一批就整批挂到freeList_上，生产者一次exchange取走全部
+ * 空闲节点放进本线程的缓存，消费者跟得上时push不分配内存。
+ * 生产者持续快于消费者(队列积压)时几乎每次push都要new一个节点，吞吐反而不如
+ * mutex+vector(vector的容量可以复用)，见net_queueinloop_bench。
+ * 生产者只会把freeList_整个取空、不会逐个弹出，所以没有ABA问题。
+ * 元素按生产者完成交换的先后顺序出队，与加锁push_back的顺序保证相同。
+ * 生产者交换完head_但还没链接next时，消费者会暂时看不到该元素及其后的元素，
+ * 调用方需要保证生产者在push之后另行通知消费者(如EventLoop::wakeup)。
+ */
+template <typename T> class MpscQueue : noncopyable {
+public:
+  MpscQueue()
+      : head_(&stub_), tail_(&stub_), free_(nullptr), freeTail_(nullptr),
+        numFree_(0), freeList_(nullptr), freeListSize_(0) {}
+
+  ~MpscQueue() {
+    Node *node;
+    while ((node = popNode()) != nullptr) {
+      delete node;
+    }
+    deleteList(free_);
+    deleteList(freeList_.load(std::memory_order_acquire));
+  }
+
+  void push(T value) {
+    Node *node = allocNode();
+    node->value = std::move(value);
+    Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  // 消费者线程调用，队列为空或者下一个元素还没链接好时返回false
+  bool pop(T *value) {
+    Node *node = popNode();
+    if (node == nullptr) {
+      return false;
+    }
+    *value = std::move(node->value);
+    recycle(node);
+    return true;
+  }
+
+  // 消费者线程调用，只处理调用时已经入队的元素，处理期间新入队的留到下一次
+  template <typename F> size_t consume(F &&f) {
+    // last为stub_时，stub_之前的元素就是调用时已入队的全部元素
+    Node *last = head_.load(std::memory_order_acquire);
+    size_t n = 0;
+    Node *node;
+    while (!(last == &stub_ && tail_ == &stub_) &&
+           (node = popNode()) != nullptr) {
+      const bool isLast = node == last;
+      f(node->value);
+      recycle(node);
+      ++n;
+      if (isLast) {
+        break;
+      }
+    }
+    return n;
+  }
+
+  // 消费者线程调用，生产者正在入队时可能返回false
+  bool empty() const {
+    return tail_ == &stub_ &&
+           head_.load(std::memory_order_acquire) == &stub_;
+  }
+
+private:
+  // 消费者每攒够kFreeBatch个空闲节点交给生产者一次，freeList_上超过kMaxFreeNodes个时
+  // 直接释放，队列曾经积压很多时不会一直占着这些内存
+  static const size_t kFreeBatch = 64;
+  static const size_t kMaxFreeNodes = 1024;
+
+  struct Node {
+    Node() : next(nullptr) {}
+    std::atomic<Node *> next;
+    T value;
+  };
+
+  // 生产者线程缓存的空闲节点，同一个T的所有队列共用，线程退出时释放
+  struct NodeCache {
+    NodeCache() : head(nullptr) {}
+    ~NodeCache() { deleteList(head); }
+    Node *head;
+  };
+
+  static void deleteList(Node *node) {
+    while (node != nullptr) {
+      Node *next = node->next.load(std::memory_order_relaxed);
+      delete node;
+      node = next;
+    }
+  }
+
+  Node *allocNode() {
+    static thread_local NodeCache cache;
+    if (cache.head == nullptr &&
+        freeList_.load(std::memory_order_relaxed) != nullptr) {
+      cache.head = freeList_.exchange(nullptr, std::memory_order_acquire);
+      // 与消费者的fetch_add有竞争，只是近似值，用来限制空闲节点的数量足够了
+      freeListSize_.store(0, std::memory_order_relaxed);
+    }
+    Node *node = cache.head;
+    if (node == nullptr) {
+      return new Node;
+    }
+    cache.head = node->next.load(std::memory_order_relaxed);
+    node->next.store(nullptr, std::memory_order_relaxed);
+    return node;
+  }
+
+  // 消费者线程调用
+  void recycle(Node *node) {
+    // 立即析构元素持有的资源(如回调捕获的TcpConnectionPtr)，不等节点被复用
+    node->value = T();
+    node->next.store(free_, std::memory_order_relaxed);
+    if (free_ == nullptr) {
+      freeTail_ = node;
+    }
+    free_ = node;
+    if (++numFree_ < kFreeBatch) {
+      return;
+    }
+    if (freeListSize_.load(std::memory_order_relaxed) >= kMaxFreeNodes) {
+      deleteList(free_);
+    } else {
+      // 只有消费者会向freeList_添加节点，CAS失败只可能是生产者把它取空了
+      Node *head = freeList_.load(std::memory_order_relaxed);
+      do {
+        freeTail_->next.store(head, std::memory_order_relaxed);
+      } while (!freeList_.compare_exchange_weak(head, free_,
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed));
+      freeListSize_.fetch_add(numFree_, std::memory_order_relaxed);
+    }
+    free_ = nullptr;
+    freeTail_ = nullptr;
+    numFree_ = 0;
+  }
+
+  Node *popNode() {
+    Node *tail = tail_;
+    Node *next = tail->next.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+      if (next == nullptr) {
+        return nullptr;
+      }
+      tail_ = next;
+      tail = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if (next != nullptr) {
+      tail_ = next;
+      return tail;
+    }
+    if (tail != head_.load(std::memory_order_acquire)) {
+      // 有生产者交换了head_但还没链接next
+      return nullptr;
+    }
+    // tail是最后一个元素，放回stub_之后才能把它摘下来
+    stub_.next.store(nullptr, std::memory_order_relaxed);
+    Node *prev = head_.exchange(&stub_, std::memory_order_acq_rel);
+    prev->next.store(&stub_, std::memory_order_release);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next != nullptr) {
+      tail_ = next;
+      return tail;
+    }
+    return nullptr;
+  }
+
+private:
+  // 生产者和消费者访问的指针放在不同的cache line上
+  alignas(64) std::atomic<Node *> head_; // 最近入队的元素
+  alignas(64) Node *tail_;               // 下一个出队的元素
+  Node stub_;
+  Node *free_;                           // 消费者正在攒的一批空闲节点
+  Node *freeTail_;
+  size_t numFree_;
+  alignas(64) std::atomic<Node *> freeList_; // 交给生产者的空闲节点
+  std::atomic<size_t> freeListSize_;
+};
+
+} // namespace mymuduo
+
+#endif // MYMUDUO_BASE_MPSCQUEUE_H
@@ -0,0 +1,167 @@
+#include "src/base/StringSearch.h"
+
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define MYMUDUO_HAVE_X86_SIMD 1
+#endif
+
+using namespace mymuduo;
+
+namespace {
+
+struct Implementation {
+  const char *name;
+  const char *(*find)(const char *, const char *, const char *, size_t);
+};
+
+// glibc的memchr本身就按CPU选择了SSE2/AVX2/EVEX版本，实测比手写的向量循环快，
+// 单字节查找直接使用它
+const char *findCharScalar(const char *begin, const char *end, char c) {
+  return static_cast<const char *>(memchr(begin, c, end - begin));
+}
+
+const char *findScalar(const char *begin, const char *end, const char *delim,
+                       size_t len) {
+  if (len == 0) {
+    return begin;
+  }
+  const char *p = begin;
+  while (static_cast<size_t>(end - p) >= len) {
+    p = findCharScalar(p, end - len + 1, delim[0]);
+    if (p == nullptr) {
+      return nullptr;
+    }
+    if (memcmp(p + 1, delim + 1, len - 1) == 0) {
+      return p;
+    }
+    ++p;
+  }
+  return nullptr;
+}
+
+#ifdef MYMUDUO_HAVE_X86_SIMD
+// 多字节分隔符：同时比较首字节和末字节，两者都匹配的位置才用memcmp确认
+const char *findSse2(const char *begin, const char *end, const char *delim,
+                     size_t len) {
+  if (len <= 1) {
+    return len == 0 ? begin : findCharScalar(begin, end, delim[0]);
+  }
+  const __m128i first = _mm_set1_epi8(delim[0]);
+  const __m128i last = _mm_set1_epi8(delim[len - 1]);
+  const char *p = begin;
+  for (; static_cast<size_t>(end - p) >= len - 1 + 16; p += 16) {
+    __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    __m128i tail =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + len - 1));
+    int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(head, first),
+                                               _mm_cmpeq_epi8(tail, last)));
+    while (mask != 0) {
+      const char *candidate = p + __builtin_ctz(mask);
+      if (memcmp(candidate + 1, delim + 1, len - 2) == 0) {
+        return candidate;
+      }
+      mask &= mask - 1;
+    }
+  }
+  return findScalar(p, end, delim, len);
+}
+
+__attribute__((target("avx2"))) const char *
+findAvx2(const char *begin, const char *end, const char *delim, size_t len) {
+  if (len <= 1) {
+    return len == 0 ? begin : findCharScalar(begin, end, delim[0]);
+  }
+  const __m256i first = _mm256_set1_epi8(delim[0]);
+  const __m256i last = _mm256_set1_epi8(delim[len - 1]);
+  const char *p = begin;
+  for (; static_cast<size_t>(end - p) >= len - 1 + 32; p += 32) {
+    __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    __m256i tail =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + len - 1));
+    unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(
+        _mm256_cmpeq_epi8(head, first), _mm256_cmpeq_epi8(tail, last)));
+    while (mask != 0) {
+      const char *candidate = p + __builtin_ctz(mask);
+      if (memcmp(candidate + 1, delim + 1, len - 2) == 0) {
+        return candidate;
+      }
+      mask &= mask - 1;
+    }
+  }
+  return findSse2(p, end, delim, len);
+}
+#endif // MYMUDUO_HAVE_X86_SIMD
+
+const Implementation kImplementations[] = {
+#ifdef MYMUDUO_HAVE_X86_SIMD
+    {"avx2", findAvx2},
+    {"sse2", findSse2},
+#endif
+    {"scalar", findScalar},
+};
+
+bool supported(const Implementation &impl) {
+#ifdef MYMUDUO_HAVE_X86_SIMD
+  __builtin_cpu_init();
+  if (strcmp(impl.name, "avx2") == 0) {
+    return __builtin_cpu_supports("avx2");
+  }
+  if (strcmp(impl.name, "sse2") == 0) {
+    return __builtin_cpu_supports("sse2");
+  }
+#endif
+  return true;
+}
+
+// 按kImplementations的顺序选第一个CPU支持的
+const Implementation *detect() {
+  for (const Implementation &impl : kImplementations) {
+    if (supported(impl)) {
+      return &impl;
+    }
+  }
+  return &kImplementations[0];
+}
+
+const Implementation *g_implementation = detect();
+
+} // namespace
+
+// 查找'\n'再检查前一个字节，HTTP头中单独的'\n'很少，比同时比较"\r\n"两个字节快
+const char *StringSearch::findCRLF(const char *begin, const char *end) {
+  if (end - begin < 2) {
+    return nullptr;
+  }
+  const char *p = begin + 1;
+  while ((p = findCharScalar(p, end, '\n')) != nullptr) {
+    if (p[-1] == '\r') {
+      return p - 1;
+    }
+    ++p;
+  }
+  return nullptr;
+}
+
+const char *StringSearch::findChar(const char *begin, const char *end,
+                                   char c) {
+  return findCharScalar(begin, end, c);
+}
+
+const char *StringSearch::find(const char *begin, const char *end,
+                               const char *delim, size_t len) {
+  return g_implementation->find(begin, end, delim, len);
+}
+
+const char *StringSearch::implementation() { return g_implementation->name; }
+
+bool StringSearch::setImplementation(const char *name) {
+  for (const Implementation &impl : kImplementations) {
+    if (strcmp(impl.name, name) == 0 && supported(impl)) {
+      g_implementation = &impl;
+      return true;
+    }
+  }
+  return false;
+}
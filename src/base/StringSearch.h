@@ -0,0 +1,27 @@
+#ifndef MYMUDUO_BASE_STRINGSEARCH_H
+#define MYMUDUO_BASE_STRINGSEARCH_H
+
+#include <stddef.h>
+
+namespace mymuduo {
+/**
+ * 在[begin, end)中查找分隔符，找不到时返回nullptr
+ * 单字节和CRLF的查找基于memchr(glibc已按CPU选择了向量化的实现)。
+ * 多字节分隔符在x86-64上有SSE2和AVX2实现，每次同时比较16/32个位置的首尾两个字节，
+ * 两者都匹配的位置再用memcmp确认，程序启动时按CPU支持的指令集选择；
+ * 其他平台使用memchr找首字节再memcmp的标量实现。
+ */
+namespace StringSearch {
+const char *findCRLF(const char *begin, const char *end);
+const char *findChar(const char *begin, const char *end, char c);
+const char *find(const char *begin, const char *end, const char *delim,
+                 size_t len);
+
+// 多字节查找当前使用的实现："avx2"、"sse2"或"scalar"
+const char *implementation();
+// 切换到指定的实现，CPU不支持或名字无效时返回false，用于测试和benchmark
+bool setImplementation(const char *name);
+} // namespace StringSearch
+} // namespace mymuduo
+
+#endif // MYMUDUO_BASE_STRINGSEARCH_H
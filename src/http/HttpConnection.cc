@@ -2,6 +2,7 @@
 #include "src/base/Timestamp.h"
 #include "src/logger/Logging.h"
 #include "src/net/Buffer.h"
+#include "src/net/BufferChain.h"
 #include "src/net/EventLoop.h"
 #include "src/net/TcpConnection.h"
 #include <fcntl.h>
@@ -88,8 +89,9 @@ void HttpConnection::processMessage(const TcpConnectionPtr &conn, Buffer *buf,
     return;
   }
 
-  makeResponse(conn->outputBuffer(), parseRet);
-  conn->send(conn->outputBuffer());
+  BufferChain response(conn->getLoop()->bufferPool());
+  makeResponse(&response, parseRet);
+  conn->send(&response);
   if (!keepAlive_) {
     conn->shutdown();
   } else {
@@ -327,7 +329,7 @@ HttpConnection::HttpCode HttpConnection::userVerify() {
   return kNoRequest;
 }
 
-void HttpConnection::makeResponse(Buffer *outputBuf, HttpCode parseRet) {
+void HttpConnection::makeResponse(BufferChain *outputBuf, HttpCode parseRet) {
   assert(parseRet != kNoRequest);
   initResponse(parseRet);
   makeResponseLine(outputBuf);
@@ -363,14 +365,14 @@ void HttpConnection::initResponse(HttpCode httpCode) {
   }
 }
 
-void HttpConnection::makeResponseLine(Buffer *outputBuf) {
+void HttpConnection::makeResponseLine(BufferChain *outputBuf) {
   assert(responseCode_ != -1);
   assert(kResponses.find(responseCode_) != kResponses.end());
   outputBuf->append("HTTP/1.1 " + std::to_string(responseCode_) + " " +
                     kResponses.at(responseCode_) + "\r\n");
 }
 
-void HttpConnection::makeResponseHeader(Buffer *outputBuf) {
+void HttpConnection::makeResponseHeader(BufferChain *outputBuf) {
   // 框架accept后对connfd设置的keep-alive是TCP选项，这里是HTTP选项
   outputBuf->append("Connection: ");
   if (header_.find("Connection") != header_.end() &&
@@ -402,14 +404,20 @@ void HttpConnection::makeResponseHeader(Buffer *outputBuf) {
   outputBuf->append("\r\n");
 }
 
-void HttpConnection::makeResponseBody(Buffer *outputBuf) {
+void HttpConnection::makeResponseBody(BufferChain *outputBuf) {
   int fd = ::open((kSourceDir + path_).c_str(), O_RDONLY);
   if (fd < 0) {
     LOG_SYSFATAL << "HttpConnection::makeResponseBody(), open error";
   }
 
-  void *mmapRet =
-      ::mmap(nullptr, requestFileStat_.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  const size_t size = requestFileStat_.st_size;
+  if (size == 0 || size >= kSendFileThreshold) {
+    // 文件内容不经过用户态内存，fd由outputBuf接管(空文件直接close)
+    outputBuf->appendFile(fd, 0, size);
+    return;
+  }
+
+  void *mmapRet = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
   if (mmapRet == MAP_FAILED) {
     LOG_SYSFATAL << "HttpConnection::makeResponseBody(), mmap error";
   }
@@ -419,11 +427,8 @@ void HttpConnection::makeResponseBody(Buffer *outputBuf) {
 
   outputBuf->append(
       static_cast<const char *>(mmapRet),
-      requestFileStat_
-          .st_size); // 是否会阻塞？  框架会先copy到mmapAddr，再从mmapAddr
-                     // copy到buffer，再写入sockfd
-                     // 能否如writev一样直接从mmapAddr写入sockfd，或直接从物理内存移到buffer中？
-  if (::munmap(mmapRet, requestFileStat_.st_size) < 0) {
+      size); // 文件内容只在这里拷贝一次，之后以writev发送
+  if (::munmap(mmapRet, size) < 0) {
     LOG_SYSERR << "HttpConnection::makeResponseBody(), munmap error";
   }
 }
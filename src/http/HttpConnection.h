@@ -11,6 +11,7 @@
 #include <sys/stat.h>
 
 namespace mymuduo {
+class BufferChain;
 
 class HttpConnection : noncopyable {
 public:
@@ -31,6 +32,8 @@ public:
 
   static const std::map<int, std::string> kResponses;
   static const std::map<std::string, std::string> kMimeType;
+  // 不小于这个大小的文件用sendfile发送，更小的文件拷贝进响应，与响应头一起writev
+  static const size_t kSendFileThreshold = 16 * 1024;
   // static const std::map<std::string, bool> kPostUserVerify;
 
   HttpConnection(const std::string &sourceDir);
@@ -50,11 +53,11 @@ private:
   HttpCode parseFromUrlEncode();
   HttpCode userVerify();
 
-  void makeResponse(Buffer *outputBuf, HttpCode parseRet);
+  void makeResponse(BufferChain *outputBuf, HttpCode parseRet);
   void initResponse(HttpCode httpCode);
-  void makeResponseLine(Buffer *outputBuf);
-  void makeResponseHeader(Buffer *outputBuf);
-  void makeResponseBody(Buffer *outputBuf);
+  void makeResponseLine(BufferChain *outputBuf);
+  void makeResponseHeader(BufferChain *outputBuf);
+  void makeResponseBody(BufferChain *outputBuf);
 
   void resetState();
 
@@ -14,12 +14,18 @@ int main() {
   Logger::useAsyncLog("./log/http", 1024 * 1024);
   EventLoop loop;
   InetAddress listenAddr("0.0.0.0", 8888);
-  TcpServer server(&loop, listenAddr, "HttpServer");
+  // 短连接多，每个subLoop各自accept，不经过baseLoop分发
+  TcpServer server(&loop, listenAddr, "HttpServer",
+                   TcpServer::kReusePortPerLoop);
 
   server.setConnectionCallback(onConnection);
   server.setMessageCallback(onMessage);
 
   server.setThreadNum(4);
+  // 每条消息都会重设连接的超时定时器
+  server.setTimingWheel(true);
+  // 响应中的文件内容只拷贝一次，未发完的部分不再进入Buffer
+  server.setChainedOutput(true);
   server.start();
   loop.loop();
 }
\ No newline at end of file
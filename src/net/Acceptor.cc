@@ -24,7 +24,8 @@ static int createNonblocking() {
 Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr,
                    bool reuseport)
     : loop_(loop), acceptSocket_(createNonblocking()),
-      acceptChannel_(loop, acceptSocket_.fd()), listening_(false),
+      acceptChannel_(loop, acceptSocket_.fd()), batchSize_(kDefaultBatchSize),
+      listening_(false),
       idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)) {
   assert(idleFd_ >= 0);
   acceptSocket_.setReuseAddr(true);
@@ -56,29 +57,42 @@ void Acceptor::listen() {
 
 void Acceptor::handleRead() {
   loop_->assertInLoopThread();
-  InetAddress peerAddr;
-  // 接受新连接
-  int connfd = acceptSocket_.accept(&peerAddr);
-  // 如果新连接到来
-  if (connfd >= 0) {
-    if (newConnectionCallback_) {
-      newConnectionCallback_(connfd, peerAddr);
-    } else {
-      if (::close(connfd) < 0) {
-        LOG_SYSERR << "Socket::handleRead(), close connected fd error";
+  // 连接风暴时backlog中积压了很多连接，一次取完，不必每个连接都等一轮epoll_wait
+  int accepted = 0;
+  while (accepted < batchSize_) {
+    InetAddress peerAddr;
+    // 接受新连接
+    int connfd = acceptSocket_.accept(&peerAddr);
+    // 如果新连接到来
+    if (connfd >= 0) {
+      ++accepted;
+      if (newConnectionCallback_) {
+        newConnectionCallback_(connfd, peerAddr);
+      } else {
+        if (::close(connfd) < 0) {
+          LOG_SYSERR << "Socket::handleRead(), close connected fd error";
+        }
       }
+      continue;
+    }
+    if (errno == EINTR || errno == ECONNABORTED) {
+      continue;
     }
-  } else {
-    LOG_SYSERR << "in Acceptor::handleRead";
-    // 当前进程的fd已经用完了
-    // 可以调整单个服务器的fd上限
-    // 也可以分布式部署
     if (errno == EMFILE) {
+      // 当前进程的fd已经用完了
+      // 可以调整单个服务器的fd上限
+      // 也可以分布式部署
       LOG_ERROR << "sockfd reached limit";
       ::close(idleFd_); // 关闭后可能被其他线程抢占fd
       idleFd_ = ::accept(acceptSocket_.fd(), nullptr, nullptr);
       ::close(idleFd_);
       idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      LOG_SYSERR << "in Acceptor::handleRead";
     }
+    break;
+  }
+  if (accepted > 0 && batchEndCallback_) {
+    batchEndCallback_();
   }
 }
@@ -13,6 +13,10 @@ class Acceptor : noncopyable {
 public:
   using NewConnectionCallback =
       std::function<void(int sockfd, const InetAddress &)>;
+  using BatchEndCallback = std::function<void()>;
+
+  // 一次可读通知最多accept的连接数
+  static const int kDefaultBatchSize = 64;
 
 public:
   Acceptor(EventLoop *loop, const InetAddress &ListenAddr,
@@ -21,6 +25,13 @@ public:
   void setNewConnectionCallback(const NewConnectionCallback &cb) {
     newConnectionCallback_ = cb;
   }
+  // 一次可读通知中的连接都交给NewConnectionCallback之后调用，
+  // TcpServer据此把这一批连接按subLoop合并分发
+  void setBatchEndCallback(const BatchEndCallback &cb) {
+    batchEndCallback_ = cb;
+  }
+  // 每次可读通知accept直到EAGAIN，最多batchSize个连接，1表示每次只accept一个
+  void setBatchSize(int batchSize) { batchSize_ = batchSize; }
 
   void listen();
 
@@ -34,6 +45,8 @@ private:
   Socket acceptSocket_;
   Channel acceptChannel_;
   NewConnectionCallback newConnectionCallback_;
+  BatchEndCallback batchEndCallback_;
+  int batchSize_;
   bool listening_; // 是否正在监听的标志
   int idleFd_;
 };
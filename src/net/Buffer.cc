@@ -1,13 +1,99 @@
 #include "src/net/Buffer.h"
 #include "src/logger/Logging.h"
+#include "src/net/BufferPool.h"
 #include <errno.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <sys/uio.h>
 #include <unistd.h>
 
 using namespace mymuduo;
 
-const char Buffer::kCRLF[] = "\r\n";
+char Buffer::emptyStorage_[kCheapPrepend];
+
+Buffer::Buffer(size_t initialSize)
+    : buffer_(emptyStorage_), capacity_(kCheapPrepend),
+      readerIndex_(kCheapPrepend), writerIndex_(kCheapPrepend),
+      pool_(nullptr), crlfScanned_(0) {
+  size_t size = kCheapPrepend + initialSize;
+  buffer_ = allocate(&size);
+  capacity_ = size;
+}
+
+Buffer::Buffer(BufferPool *pool)
+    : buffer_(emptyStorage_), capacity_(kCheapPrepend),
+      readerIndex_(kCheapPrepend), writerIndex_(kCheapPrepend), pool_(pool),
+      crlfScanned_(0) {}
+
+Buffer::~Buffer() { deallocate(); }
+
+void Buffer::releaseIfEmpty() {
+  if (readableBytes() == 0) {
+    deallocate();
+    readerIndex_ = kCheapPrepend;
+    writerIndex_ = kCheapPrepend;
+  }
+}
+
+void Buffer::takeAll(Buffer *rhs) {
+  if (rhs == this) {
+    return;
+  }
+  if (readableBytes() == 0 && pool_ == rhs->pool_) {
+    swap(*rhs);
+  } else {
+    append(rhs->peek(), rhs->readableBytes());
+  }
+  rhs->retrieveAll();
+}
+
+char *Buffer::allocate(size_t *size) {
+  if (pool_ != nullptr) {
+    return pool_->allocate(size);
+  }
+  char *p = static_cast<char *>(::malloc(*size));
+  if (p == nullptr) {
+    LOG_FATAL << "Buffer::allocate() out of memory";
+  }
+  return p;
+}
+
+void Buffer::deallocate() {
+  if (buffer_ == emptyStorage_) {
+    return;
+  }
+  if (pool_ != nullptr) {
+    pool_->deallocate(buffer_, capacity_);
+  } else {
+    ::free(buffer_);
+  }
+  buffer_ = emptyStorage_;
+  capacity_ = kCheapPrepend;
+}
+
+void Buffer::makeSpace(size_t len) {
+  // 如果整个buffer都不够用，换一块更大的内存，只拷贝可读数据
+  if (writableBytes() + prependableBytes() < len + kCheapPrepend) {
+    const size_t readable = readableBytes();
+    // 按倍数增长，避免反复append时每次都拷贝
+    size_t size = std::max(kCheapPrepend + readable + len, capacity_ * 2);
+    char *p = allocate(&size);
+    memcpy(p + kCheapPrepend, peek(), readable);
+    deallocate();
+    buffer_ = p;
+    capacity_ = size;
+    readerIndex_ = kCheapPrepend;
+    writerIndex_ = readerIndex_ + readable;
+  } else { // 如果整个buffer够用，将后面移动到前面继续分配
+    size_t readable = readableBytes();
+    std::copy(begin() + readerIndex_, begin() + writerIndex_,
+              begin() + kCheapPrepend);
+    readerIndex_ = kCheapPrepend;
+    writerIndex_ = readerIndex_ + readable;
+    assert(readableBytes() == readable);
+  }
+}
 
 /**
  * 从fd上读取数据 Poller工作在LT模式
@@ -56,3 +142,42 @@ ssize_t Buffer::readFd(int fd, int *saveErrno) {
   }
   return n;
 }
+
+// 可写空间按预测预留，绝大多数读取直接落在Buffer中；预测偏小时仍由extrabuf兜底，
+// 保证一次系统调用读取的数据量不比readFd(int, int *)少
+ssize_t Buffer::readFd(int fd, int *saveErrno, ReadSizePredictor *predictor) {
+  size_t expected = predictor->nextReadSize();
+  if (predictor->queryFionread()) {
+    int available = 0;
+    if (::ioctl(fd, FIONREAD, &available) == 0 &&
+        static_cast<size_t>(available) > expected) {
+      expected = std::min(static_cast<size_t>(available),
+                          static_cast<size_t>(ReadSizePredictor::kMaxReadSize));
+    }
+  }
+  // 预测值都是2的幂，扣掉kCheapPrepend后空的Buffer正好占用BufferPool的一级
+  ensureWriteableBytes(expected - kCheapPrepend);
+
+  char extrabuf[65536];
+  struct iovec vec[2];
+  const size_t writable = writableBytes();
+  vec[0].iov_base = beginWrite();
+  vec[0].iov_len = writable;
+  vec[1].iov_base = extrabuf;
+  vec[1].iov_len = sizeof extrabuf;
+  const int iovcnt = (writable < sizeof extrabuf) ? 2 : 1;
+  const ssize_t n = ::readv(fd, vec, iovcnt);
+
+  if (n < 0) {
+    *saveErrno = errno;
+    return n;
+  }
+  predictor->record(n, writable);
+  if (static_cast<size_t>(n) <= writable) {
+    hasWritten(n);
+  } else {
+    hasWritten(writable);
+    append(extrabuf, n - writable);
+  }
+  return n;
+}
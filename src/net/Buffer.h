@@ -1,13 +1,64 @@
 #ifndef MYMUDUO_NET_BUFFER_H
 #define MYMUDUO_NET_BUFFER_H
+#include "src/base/StringSearch.h"
 #include "src/base/noncopyable.h"
 #include <algorithm>
 #include <assert.h>
 #include <string>
-#include <vector>
 #include <string.h>
 
 namespace mymuduo {
+class BufferPool;
+
+/**
+ * 根据最近几次读到的字节数预测下一次readFd需要的可写空间，每个连接一个
+ * 读满了预测值就翻倍，连续两次读到的不足预测值的一半才减半，
+ * 这样大流量的连接很快扩大到一次能读完，偶尔的小包不会立刻缩小。
+ * 开启queryFionread时先用FIONREAD查询socket中已有的字节数，多一次系统调用，
+ * 但突发的大块数据也能一次读进Buffer。
+ */
+class ReadSizePredictor {
+public:
+  static const size_t kMinReadSize = 1024;
+  static const size_t kInitialReadSize = 4096;
+  static const size_t kMaxReadSize = 256 * 1024;
+
+  ReadSizePredictor()
+      : nextReadSize_(kInitialReadSize), lastSpilled_(0), shrinkPending_(false),
+        queryFionread_(false) {}
+
+  size_t nextReadSize() const { return nextReadSize_; }
+  // 上一次读溢出到extrabuf的字节数
+  size_t lastSpilled() const { return lastSpilled_; }
+
+  void setQueryFionread(bool on) { queryFionread_ = on; }
+  bool queryFionread() const { return queryFionread_; }
+
+  // 可写空间为writable时读到了n字节
+  void record(size_t n, size_t writable) {
+    lastSpilled_ = n > writable ? n - writable : 0;
+    if (n >= nextReadSize_) {
+      nextReadSize_ =
+          nextReadSize_ * 2 < kMaxReadSize ? nextReadSize_ * 2 : kMaxReadSize;
+      shrinkPending_ = false;
+    } else if (n <= nextReadSize_ / 2) {
+      if (shrinkPending_) {
+        nextReadSize_ =
+            nextReadSize_ / 2 > kMinReadSize ? nextReadSize_ / 2 : kMinReadSize;
+      }
+      shrinkPending_ = !shrinkPending_;
+    } else {
+      shrinkPending_ = false;
+    }
+  }
+
+private:
+  size_t nextReadSize_;
+  size_t lastSpilled_;
+  bool shrinkPending_;
+  bool queryFionread_;
+};
+
 class Buffer : noncopyable {
 public:
   // prependable 初始大小，readIndex 初始位置
@@ -15,16 +66,28 @@ public:
   // writeable 初始大小，writeIndex 初始位置
   // 刚开始 readerIndex 和 writerIndex 处于同一位置
   static const size_t kInitialSize = 1024;
-  explicit Buffer(size_t initialSize = kInitialSize)
-      : buffer_(kCheapPrepend + initialSize), readerIndex_(kCheapPrepend),
-        writerIndex_(kCheapPrepend) {}
+  explicit Buffer(size_t initialSize = kInitialSize);
+  // 内存从pool借用，初始不占内存，数据清空后可以用releaseIfEmpty归还
+  explicit Buffer(BufferPool *pool);
+  ~Buffer();
+  // 连同内存池一起交换，两个缓冲区的内存池不同时会改变各自内存的归属
   void swap(Buffer& rhs) {
-    buffer_.swap(rhs.buffer_);
+    std::swap(buffer_, rhs.buffer_);
+    std::swap(capacity_, rhs.capacity_);
     std::swap(readerIndex_, rhs.readerIndex_);
     std::swap(writerIndex_, rhs.writerIndex_);
+    std::swap(pool_, rhs.pool_);
+    std::swap(crlfScanned_, rhs.crlfScanned_);
   }
+  // 把rhs的全部数据移到末尾，rhs变为空，两者都保留原来的内存池
+  // 本缓冲区为空且内存池相同时直接交换内存，否则拷贝到本缓冲区的内存池
+  void takeAll(Buffer *rhs);
   size_t readableBytes() const { return writerIndex_ - readerIndex_; }
-  size_t writableBytes() const { return buffer_.size() - writerIndex_; }
+  size_t writableBytes() const { return capacity_ - writerIndex_; }
+  // 底层内存的大小
+  size_t internalCapacity() const { return capacity_; }
+  // 没有可读数据时归还底层内存，之后写入时再重新分配
+  void releaseIfEmpty();
   size_t prependableBytes() const { return readerIndex_; }
   // 返回缓冲区中可读数据的起始地址
   const char *peek() const { return begin() + readerIndex_; }
@@ -34,6 +97,7 @@ public:
     if (len < readableBytes()) {
       // 移动可读缓冲区指针
       readerIndex_ += len;
+      crlfScanned_ = crlfScanned_ > len ? crlfScanned_ - len : 0;
     }
     // 全部读完 len == readableBytes()
     else {
@@ -48,6 +112,7 @@ public:
   void retrieveAll() {
     readerIndex_ = kCheapPrepend;
     writerIndex_ = kCheapPrepend;
+    crlfScanned_ = 0;
   }
   std::string retrieveAllAsString() {
     return retrieveAsString(readableBytes());
@@ -79,53 +144,66 @@ public:
   const char *beginWrite() const { return begin() + writerIndex_; }
   // 从fd上读取数据
   ssize_t readFd(int fd, int *saveErrno);
+  // 先按predictor的预测(或FIONREAD)预留可写空间，使数据直接读进Buffer，再更新预测
+  ssize_t readFd(int fd, int *saveErrno, ReadSizePredictor *predictor);
 
+  // 可恢复的查找：没有找到时记住扫描到的位置，下次调用从那里继续，
+  // 一行数据分多次到达时不会从peek()重新扫描
   const char *findCRLF() const {
-    const char *crlf = std::search(peek(), beginWrite(), kCRLF, kCRLF + 2);
-    return crlf == beginWrite() ? NULL : crlf;
+    const char *crlf = StringSearch::findCRLF(peek() + crlfScanned_, beginWrite());
+    if (crlf != nullptr) {
+      crlfScanned_ = crlf - peek();
+    } else if (readableBytes() > 0) {
+      // 最后一个字节可能是'\r'，'\n'还没有到达
+      crlfScanned_ = readableBytes() - 1;
+    }
+    return crlf;
   }
 
   const char *findCRLF(const char *start) const {
     assert(peek() <= start);
     assert(start <= beginWrite());
-    const char *crlf = std::search(start, beginWrite(), kCRLF, kCRLF + 2);
-    return crlf == beginWrite() ? NULL : crlf;
+    return StringSearch::findCRLF(start, beginWrite());
   }
 
   const char *findEOL() const {
-    const void *eol = memchr(peek(), '\n', readableBytes());
-    return static_cast<const char *>(eol);
+    return StringSearch::findChar(peek(), beginWrite(), '\n');
   }
 
   const char *findEOL(const char *start) const {
     assert(peek() <= start);
     assert(start <= beginWrite());
-    const void *eol = memchr(start, '\n', beginWrite() - start);
-    return static_cast<const char *>(eol);
+    return StringSearch::findChar(start, beginWrite(), '\n');
   }
 
-private:
-  char *begin() { return buffer_.data(); }
-  const char *begin() const { return &*buffer_.begin(); }
-  void makeSpace(size_t len) {
-    // 如果整个buffer都不够用
-    if (writableBytes() + prependableBytes() < len + kCheapPrepend) {
-      buffer_.resize(writerIndex_ + len);
-    } else { // 如果整个buffer够用，将后面移动到前面继续分配
-      size_t readable = readableBytes();
-      std::copy(begin() + readerIndex_, begin() + writerIndex_,
-                begin() + kCheapPrepend);
-      readerIndex_ = kCheapPrepend;
-      writerIndex_ = readerIndex_ + readable;
-      assert(readableBytes() == readable);
-    }
+  // 查找任意的多字节分隔符，如"\r\n\r\n"
+  const char *find(const char *delim, size_t len) const {
+    return StringSearch::find(peek(), beginWrite(), delim, len);
+  }
+
+  const char *find(const char *start, const char *delim, size_t len) const {
+    assert(peek() <= start);
+    assert(start <= beginWrite());
+    return StringSearch::find(start, beginWrite(), delim, len);
   }
 
 private:
-  std::vector<char> buffer_;
+  char *begin() { return buffer_; }
+  const char *begin() const { return buffer_; }
+  void makeSpace(size_t len);
+  char *allocate(size_t *size);
+  void deallocate();
+
+private:
+  char *buffer_;
+  size_t capacity_;
   size_t readerIndex_;
   size_t writerIndex_;
-  static const char kCRLF[];
+  BufferPool *pool_; // 为空时直接malloc/free
+  // findCRLF()已经扫描过、确定不含CRLF起点的字节数(从peek()算起)
+  mutable size_t crlfScanned_;
+  // 没有底层内存时buffer_指向这里，只有kCheapPrepend字节，不会被写入
+  static char emptyStorage_[kCheapPrepend];
 };
 }; // namespace mymuduo
 
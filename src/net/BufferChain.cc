@@ -0,0 +1,464 @@
+#include "src/net/BufferChain.h"
+#include "src/net/Buffer.h"
+#include "src/net/BufferPool.h"
+#include "src/net/EventLoopStats.h"
+#include "src/logger/Logging.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <errno.h>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <utility>
+
+using namespace mymuduo;
+
+BufferChain::BufferChain(BufferPool *pool)
+    : pool_(pool), head_(nullptr), tail_(nullptr), numBlocks_(0),
+      numFileRanges_(0), readable_(0), zeroCopyThreshold_(0), stats_(nullptr),
+      zeroCopyIssued_(0), zeroCopyDone_(0), pinnedHead_(nullptr),
+      pinnedTail_(nullptr), numPinned_(0) {}
+
+BufferChain::~BufferChain() {
+  retrieveAll();
+  // 内核还在用这些块发送和重传排队的数据，复用它们会把别的数据甚至别的连接的数据
+  // 发到线上，收不到完成通知时只能泄漏。正常情况下pinned块已经交给了EventLoop等待
+  if (pinnedHead_ != nullptr) {
+    LOG_WARN << "BufferChain::~BufferChain() leaks " << numPinned_
+             << " blocks still referenced by MSG_ZEROCOPY sends";
+  }
+}
+
+void BufferChain::swap(BufferChain &rhs) {
+  std::swap(pool_, rhs.pool_);
+  std::swap(head_, rhs.head_);
+  std::swap(tail_, rhs.tail_);
+  std::swap(numBlocks_, rhs.numBlocks_);
+  std::swap(numFileRanges_, rhs.numFileRanges_);
+  std::swap(readable_, rhs.readable_);
+  std::swap(zeroCopyThreshold_, rhs.zeroCopyThreshold_);
+  std::swap(stats_, rhs.stats_);
+  std::swap(zeroCopyIssued_, rhs.zeroCopyIssued_);
+  std::swap(zeroCopyDone_, rhs.zeroCopyDone_);
+  zeroCopyOutOfOrder_.swap(rhs.zeroCopyOutOfOrder_);
+  std::swap(pinnedHead_, rhs.pinnedHead_);
+  std::swap(pinnedTail_, rhs.pinnedTail_);
+  std::swap(numPinned_, rhs.numPinned_);
+}
+
+BufferChain::Block *BufferChain::newBlock() {
+  static_assert(sizeof(Block) == kBlockSize,
+                "Block should fill one BufferPool block");
+  Block *block;
+  if (pool_ != nullptr) {
+    size_t size = kBlockSize;
+    block = reinterpret_cast<Block *>(pool_->allocate(&size));
+    assert(size == kBlockSize);
+  } else {
+    block = static_cast<Block *>(::malloc(kBlockSize));
+    if (block == nullptr) {
+      LOG_FATAL << "BufferChain::newBlock() out of memory";
+    }
+  }
+  block->next = nullptr;
+  block->begin = 0;
+  block->end = 0;
+  block->fd = kMemoryBlock;
+  return block;
+}
+
+void BufferChain::freeBlock(Block *block) {
+  if (block->fd >= 0) {
+    if (::close(block->fd) < 0) {
+      LOG_SYSERR << "BufferChain::freeBlock() close";
+    }
+    ::free(block);
+  } else if (block->fd == kSharedBlock) {
+    payloadOf(block)->~SharedPayload();
+    ::free(block);
+  } else if (pool_ != nullptr) {
+    pool_->deallocate(reinterpret_cast<char *>(block), kBlockSize);
+  } else {
+    ::free(block);
+  }
+}
+
+void BufferChain::pushBack(Block *block) {
+  block->next = nullptr;
+  if (tail_ == nullptr) {
+    head_ = block;
+  } else {
+    tail_->next = block;
+  }
+  tail_ = block;
+  ++numBlocks_;
+  if (block->fd >= 0) {
+    ++numFileRanges_;
+  }
+}
+
+void BufferChain::append(const char *data, size_t len) {
+  readable_ += len;
+  while (len > 0) {
+    if (tail_ == nullptr || tail_->fd != kMemoryBlock ||
+        tail_->end == kBlockDataSize) {
+      pushBack(newBlock());
+    }
+    size_t n = std::min(len, kBlockDataSize - tail_->end);
+    memcpy(tail_->data + tail_->end, data, n);
+    tail_->end += n;
+    data += n;
+    len -= n;
+  }
+}
+
+void BufferChain::appendFile(int fd, off_t offset, size_t len) {
+  if (len == 0) {
+    if (::close(fd) < 0) {
+      LOG_SYSERR << "BufferChain::appendFile() close";
+    }
+    return;
+  }
+  Block *block = static_cast<Block *>(::malloc(offsetof(Block, data)));
+  if (block == nullptr) {
+    LOG_FATAL << "BufferChain::appendFile() out of memory";
+  }
+  block->begin = static_cast<size_t>(offset);
+  block->end = block->begin + len;
+  block->fd = fd;
+  pushBack(block);
+  readable_ += len;
+}
+
+void BufferChain::appendShared(const SharedPayload &payload, size_t offset,
+                               size_t len) {
+  assert(offset + len <= payload->size());
+  if (len == 0) {
+    return;
+  }
+  Block *block = static_cast<Block *>(
+      ::malloc(kPayloadOffset + sizeof(SharedPayload)));
+  if (block == nullptr) {
+    LOG_FATAL << "BufferChain::appendShared() out of memory";
+  }
+  new (payloadOf(block)) SharedPayload(payload);
+  block->begin = offset;
+  block->end = offset + len;
+  block->fd = kSharedBlock;
+  pushBack(block);
+  readable_ += len;
+}
+
+void BufferChain::splice(BufferChain *other) {
+  if (other == this || other->head_ == nullptr) {
+    return;
+  }
+  if (other->pool_ != pool_) {
+    // 内存块同样直接转移，之后由本链归还，借出计数随之转到本链的池
+    for (Block *block = other->head_; block != nullptr; block = block->next) {
+      if (block->fd != kMemoryBlock) {
+        continue;
+      }
+      if (other->pool_ != nullptr) {
+        other->pool_->disown(kBlockSize);
+      }
+      if (pool_ != nullptr) {
+        pool_->adopt(kBlockSize);
+      }
+    }
+  }
+  if (tail_ == nullptr) {
+    head_ = other->head_;
+  } else {
+    tail_->next = other->head_;
+  }
+  tail_ = other->tail_;
+  numBlocks_ += other->numBlocks_;
+  numFileRanges_ += other->numFileRanges_;
+  readable_ += other->readable_;
+  other->head_ = other->tail_ = nullptr;
+  other->numBlocks_ = 0;
+  other->numFileRanges_ = 0;
+  other->readable_ = 0;
+}
+
+void BufferChain::popFront() {
+  Block *block = head_;
+  head_ = block->next;
+  if (head_ == nullptr) {
+    tail_ = nullptr;
+  }
+  --numBlocks_;
+  if (block->fd >= 0) {
+    --numFileRanges_;
+  } else if (zeroCopyDone_ < zeroCopyIssued_) {
+    // 块中的数据可能还被之前的MSG_ZEROCOPY发送引用着
+    block->next = nullptr;
+    block->begin = zeroCopyIssued_;
+    if (pinnedTail_ == nullptr) {
+      pinnedHead_ = block;
+    } else {
+      pinnedTail_->next = block;
+    }
+    pinnedTail_ = block;
+    ++numPinned_;
+    return;
+  }
+  freeBlock(block);
+}
+
+void BufferChain::enableZeroCopy(size_t threshold, EventLoopStats *stats) {
+  zeroCopyThreshold_ = threshold;
+  stats_ = stats;
+}
+
+void BufferChain::zeroCopyCompleted(uint32_t lo, uint32_t hi, bool copied) {
+  // 内核的编号是32位的，按与zeroCopyDone_的距离展开成64位
+  const uint32_t base = static_cast<uint32_t>(zeroCopyDone_);
+  const uint64_t first = zeroCopyDone_ + static_cast<uint32_t>(lo - base);
+  const uint64_t last = first + static_cast<uint32_t>(hi - lo);
+  if (copied && stats_ != nullptr) {
+    stats_->zeroCopyKernelCopied.record(last - first + 1);
+  }
+  if (first != zeroCopyDone_) {
+    zeroCopyOutOfOrder_.emplace_back(first, last);
+    return;
+  }
+  zeroCopyDone_ = last + 1;
+  // 之前乱序到达的区间可能已经接上
+  bool merged = true;
+  while (merged && !zeroCopyOutOfOrder_.empty()) {
+    merged = false;
+    for (size_t i = 0; i < zeroCopyOutOfOrder_.size(); ++i) {
+      if (zeroCopyOutOfOrder_[i].first == zeroCopyDone_) {
+        zeroCopyDone_ = zeroCopyOutOfOrder_[i].second + 1;
+        zeroCopyOutOfOrder_[i] = zeroCopyOutOfOrder_.back();
+        zeroCopyOutOfOrder_.pop_back();
+        merged = true;
+        break;
+      }
+    }
+  }
+  releasePinned();
+}
+
+void BufferChain::readZeroCopyCompletions(int fd) {
+  char control[128];
+  for (;;) {
+    struct msghdr msg;
+    memset(&msg, 0, sizeof msg);
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof control;
+    if (::recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        LOG_SYSERR << "BufferChain::readZeroCopyCompletions() fd=" << fd;
+      }
+      break;
+    }
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != nullptr;
+         cm = CMSG_NXTHDR(&msg, cm)) {
+      if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+          !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)) {
+        continue;
+      }
+      const struct sock_extended_err *serr =
+          reinterpret_cast<const struct sock_extended_err *>(CMSG_DATA(cm));
+      if (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY || serr->ee_errno != 0) {
+        LOG_ERROR << "BufferChain::readZeroCopyCompletions() fd=" << fd
+                  << " origin = " << serr->ee_origin
+                  << " errno = " << serr->ee_errno;
+        continue;
+      }
+      // ee_info~ee_data为完成的发送编号区间
+      zeroCopyCompleted(serr->ee_info, serr->ee_data,
+                        (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0);
+    }
+  }
+}
+
+void BufferChain::releasePinned() {
+  // 块按编号递增的顺序挂上链表
+  while (pinnedHead_ != nullptr && pinnedHead_->begin <= zeroCopyDone_) {
+    Block *block = pinnedHead_;
+    pinnedHead_ = block->next;
+    if (pinnedHead_ == nullptr) {
+      pinnedTail_ = nullptr;
+    }
+    --numPinned_;
+    freeBlock(block);
+  }
+}
+
+void BufferChain::retrieve(size_t len) {
+  assert(len <= readable_);
+  readable_ -= len;
+  while (len > 0) {
+    size_t n = std::min(len, head_->end - head_->begin);
+    head_->begin += n;
+    len -= n;
+    if (head_->begin == head_->end) {
+      popFront();
+    }
+  }
+}
+
+void BufferChain::retrieveAll() {
+  while (head_ != nullptr) {
+    popFront();
+  }
+  readable_ = 0;
+}
+
+std::string BufferChain::retrieveAllAsString() {
+  std::string result(readable_, '\0');
+  char *dest = &result[0];
+  for (Block *block = head_; block != nullptr; block = block->next) {
+    const size_t len = block->end - block->begin;
+    if (block->fd >= 0) {
+      readFileRange(block, dest);
+    } else {
+      memcpy(dest, peekBlock(block), len);
+    }
+    dest += len;
+  }
+  retrieveAll();
+  return result;
+}
+
+void BufferChain::retrieveAllInto(Buffer *buf) {
+  buf->ensureWriteableBytes(readable_);
+  for (Block *block = head_; block != nullptr; block = block->next) {
+    const size_t len = block->end - block->begin;
+    if (block->fd >= 0) {
+      readFileRange(block, buf->beginWrite());
+      buf->hasWritten(len);
+    } else {
+      buf->append(peekBlock(block), len);
+    }
+  }
+  retrieveAll();
+}
+
+void BufferChain::readFileRange(const Block *block, char *dest) {
+  size_t done = 0;
+  const size_t len = block->end - block->begin;
+  while (done < len) {
+    ssize_t n = ::pread(block->fd, dest + done, len - done,
+                        static_cast<off_t>(block->begin + done));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      // 文件被截断，缺少的部分补0，保持长度不变
+      LOG_SYSERR << "BufferChain::readFileRange() pread";
+      memset(dest + done, 0, len - done);
+      return;
+    }
+    done += n;
+  }
+}
+
+ssize_t BufferChain::writeFd(int fd, int *savedErrno, size_t maxBytes,
+                             size_t *attempted) {
+  size_t total = 0;
+  size_t totalAttempted = 0;
+  ssize_t n = 0;
+  while (head_ != nullptr && total < maxBytes) {
+    size_t tried = 0;
+    n = writeOnce(fd, savedErrno, maxBytes - total, &tried);
+    totalAttempted += tried;
+    if (n < 0) {
+      break;
+    }
+    if (n == 0) {
+      // 丢弃了被截断的文件区间
+      continue;
+    }
+    total += n;
+    if (static_cast<size_t>(n) < tried) {
+      // 发送缓冲区已满
+      break;
+    }
+  }
+  if (attempted != nullptr) {
+    *attempted = totalAttempted;
+  }
+  return total > 0 ? static_cast<ssize_t>(total) : n;
+}
+
+ssize_t BufferChain::writeOnce(int fd, int *savedErrno, size_t maxBytes,
+                               size_t *attempted) {
+  if (head_->fd >= 0) {
+    const size_t len = std::min(head_->end - head_->begin, maxBytes);
+    *attempted = len;
+    off_t offset = static_cast<off_t>(head_->begin);
+    const ssize_t n = ::sendfile(fd, head_->fd, &offset, len);
+    if (n < 0) {
+      *savedErrno = errno;
+    } else if (n == 0) {
+      // 文件比区间短，丢弃剩余的部分，否则会一直可写却发不出数据
+      LOG_ERROR << "BufferChain::writeFd() file fd " << head_->fd
+                << " truncated, " << head_->end - head_->begin
+                << " bytes dropped";
+      retrieve(head_->end - head_->begin);
+      *attempted = 0;
+    } else {
+      retrieve(n);
+    }
+    return n;
+  }
+
+  struct iovec vec[kMaxIovecs];
+  int iovcnt = 0;
+  size_t total = 0;
+  for (Block *block = head_; block != nullptr && block->fd < 0 &&
+                             iovcnt < kMaxIovecs && total < maxBytes;
+       block = block->next) {
+    size_t len = std::min(block->end - block->begin, maxBytes - total);
+    vec[iovcnt].iov_base = const_cast<char *>(peekBlock(block));
+    vec[iovcnt].iov_len = len;
+    ++iovcnt;
+    total += len;
+  }
+  *attempted = total;
+
+  if (zeroCopyThreshold_ > 0 && total >= zeroCopyThreshold_) {
+    struct msghdr msg;
+    memset(&msg, 0, sizeof msg);
+    msg.msg_iov = vec;
+    msg.msg_iovlen = iovcnt;
+    const ssize_t n = ::sendmsg(fd, &msg, MSG_ZEROCOPY);
+    if (n >= 0) {
+      // 先增加编号，这次发送完的块挂到pinned链表上
+      ++zeroCopyIssued_;
+      if (stats_ != nullptr) {
+        stats_->zeroCopySendBytes.record(n);
+      }
+      retrieve(n);
+      return n;
+    }
+    if (errno != ENOBUFS) {
+      *savedErrno = errno;
+      return n;
+    }
+    // 超出了optmem_max的限制，这一次拷贝发送
+  }
+
+  const ssize_t n = ::writev(fd, vec, iovcnt);
+  if (n < 0) {
+    *savedErrno = errno;
+  } else {
+    if (zeroCopyThreshold_ > 0 && stats_ != nullptr) {
+      stats_->zeroCopyFallbackBytes.record(n);
+    }
+    retrieve(n);
+  }
+  return n;
+}
@@ -0,0 +1,160 @@
+#ifndef MYMUDUO_NET_BUFFERCHAIN_H
+#define MYMUDUO_NET_BUFFERCHAIN_H
+
+#include "src/base/noncopyable.h"
+
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+namespace mymuduo {
+class Buffer;
+class BufferPool;
+class EventLoopStats;
+
+// 不可变的引用计数消息，广播给多个连接时各个发送缓冲区只保存引用，不拷贝
+using SharedPayload = std::shared_ptr<const std::string>;
+
+/**
+ * 由固定大小的数据块串成的发送缓冲区
+ * 与Buffer不同，追加数据时只在末尾挂新块，已有数据不会因扩容或腾挪空间而再次拷贝；
+ * 两个BufferChain之间可以直接转移数据块(splice)，不拷贝数据。
+ * 发送时用一次writev把多个块一起写出。数据块可以从EventLoop的BufferPool借用，取走后立即归还。
+ * 链上也可以挂文件区间，文件内容不进入内存，轮到它时用sendfile发送，与前后的数据保持顺序。
+ * 共享消息(SharedPayload)以引用挂在链上，和内存块一起用writev发送，发送完后释放引用。
+ * 开启零拷贝后大块数据以MSG_ZEROCOPY发送，内核直接引用块中的内存，
+ * 发送过的块挂到pinned链表上，等错误队列中的完成通知到达后再释放。
+ *
+ * +--------+     +--------+     +--------+     +--------+
+ * | block  | --> | shared | --> |  file  | --> | block  |
+ * +--------+     +--------+     +--------+     +--------+
+ *   ^begin      payload,[b,e)  fd,[off,end)        ^end
+ */
+class BufferChain : noncopyable {
+public:
+  // 每块的大小(含块头)，正好是BufferPool的一级
+  static const size_t kBlockSize = 16 * 1024;
+  // 一次writev最多的块数
+  static const int kMaxIovecs = 64;
+
+  // pool为空时数据块直接malloc/free
+  explicit BufferChain(BufferPool *pool = nullptr);
+  ~BufferChain();
+
+  void swap(BufferChain &rhs);
+
+  // 包括文件区间的字节数
+  size_t readableBytes() const { return readable_; }
+  // 数据分成了多少块(含文件区间)
+  size_t numBlocks() const { return numBlocks_; }
+  // 其中文件区间的个数
+  size_t numFileRanges() const { return numFileRanges_; }
+
+  void append(const char *data, size_t len);
+  void append(const std::string &str) { append(str.data(), str.size()); }
+  // 追加文件fd中[offset, offset + len)的内容，不读入内存
+  // fd由BufferChain接管，区间发送完或被丢弃时close，同一个fd只能追加一次
+  void appendFile(int fd, off_t offset, size_t len);
+  // 以引用追加payload中[offset, offset + len)的内容，不拷贝
+  void appendShared(const SharedPayload &payload, size_t offset, size_t len);
+  void appendShared(const SharedPayload &payload) {
+    appendShared(payload, 0, payload->size());
+  }
+
+  // 把other的所有数据接到末尾，other变为空，数据块直接转移，不拷贝
+  // 两者的BufferPool不同时，内存块的借出计数转到本链的池，之后归还给本链的池
+  void splice(BufferChain *other);
+
+  void retrieve(size_t len);
+  void retrieveAll();
+  // 文件区间的内容用pread读出
+  std::string retrieveAllAsString();
+  // 把全部数据拷贝到buf末尾
+  void retrieveAllInto(Buffer *buf);
+
+  // 写出最多maxBytes字节，写出的部分从缓冲区中取走
+  // 连续的内存块用一次writev写出，文件区间用sendfile，一次写完时继续写下一段
+  // *attempted为交给系统调用的字节数，返回值为写出的字节数，一个字节都没写出时同writev
+  ssize_t writeFd(int fd, int *savedErrno, size_t maxBytes = SIZE_MAX,
+                  size_t *attempted = nullptr);
+
+  // 连续内存块一次发送不少于threshold字节时以MSG_ZEROCOPY发送，socket需要先设置SO_ZEROCOPY
+  // stats不为空时记录零拷贝和拷贝发送的字节数
+  void enableZeroCopy(size_t threshold, EventLoopStats *stats);
+  // 错误队列中的完成通知：第lo~hi次MSG_ZEROCOPY发送已完成，copied表示内核改为了拷贝
+  void zeroCopyCompleted(uint32_t lo, uint32_t hi, bool copied);
+  // 读出socket fd错误队列中所有的完成通知，交给zeroCopyCompleted
+  void readZeroCopyCompletions(int fd);
+  // 等待完成通知、还不能释放的块数
+  // 不为0时内核还会读这些块(包括socket关闭后的重传)，块不能还给BufferPool复用，
+  // 需要保留socket直到通知全部到达，见EventLoop::adoptZeroCopyChain
+  size_t numPinnedBlocks() const { return numPinned_; }
+
+private:
+  // 文件区间只分配到data之前的块头，begin/end为文件偏移；
+  // 共享消息在块头之后存放SharedPayload，begin/end为payload中的位置
+  struct Block {
+    Block *next;
+    size_t begin; // 可读数据的起始位置
+    size_t end;   // 可读数据的结束位置
+    int fd;       // 文件区间的fd，内存块为kMemoryBlock，共享消息为kSharedBlock
+    char data[kBlockSize - sizeof(Block *) - 2 * sizeof(size_t) - sizeof(int)];
+  };
+  static const size_t kBlockDataSize = sizeof(Block::data);
+  static const int kMemoryBlock = -1;
+  static const int kSharedBlock = -2;
+  // 共享消息块中SharedPayload的位置，按其对齐要求从data向后对齐
+  static const size_t kPayloadOffset =
+      (offsetof(Block, data) + alignof(SharedPayload) - 1) &
+      ~(alignof(SharedPayload) - 1);
+
+  static SharedPayload *payloadOf(Block *block) {
+    return reinterpret_cast<SharedPayload *>(reinterpret_cast<char *>(block) +
+                                             kPayloadOffset);
+  }
+  // 内存块和共享消息块可读数据的起始地址
+  static const char *peekBlock(const Block *block) {
+    if (block->fd == kSharedBlock) {
+      return (*payloadOf(const_cast<Block *>(block)))->data() + block->begin;
+    }
+    return block->data + block->begin;
+  }
+
+  Block *newBlock();
+  void freeBlock(Block *block);
+  void pushBack(Block *block);
+  // 释放第一块，还有未完成的零拷贝发送时挂到pinned链表上
+  void popFront();
+  // 释放完成通知已经覆盖的pinned块
+  void releasePinned();
+  // 从head_开始的连续内存块用一次writev写出，文件区间用一次sendfile写出
+  ssize_t writeOnce(int fd, int *savedErrno, size_t maxBytes,
+                    size_t *attempted);
+  // 用pread把文件区间的内容读到dest
+  static void readFileRange(const Block *block, char *dest);
+
+  BufferPool *pool_;
+  Block *head_;
+  Block *tail_;
+  size_t numBlocks_;
+  size_t numFileRanges_;
+  size_t readable_;
+
+  size_t zeroCopyThreshold_; // 0表示不使用MSG_ZEROCOPY
+  EventLoopStats *stats_;
+  uint64_t zeroCopyIssued_; // 已发出的MSG_ZEROCOPY发送次数，即下一次发送的编号
+  uint64_t zeroCopyDone_;   // 编号小于它的发送都已完成
+  std::vector<std::pair<uint64_t, uint64_t>> zeroCopyOutOfOrder_; // 乱序到达的完成区间
+  // pinned块的begin记录释放前需要等到的zeroCopyDone_
+  Block *pinnedHead_;
+  Block *pinnedTail_;
+  size_t numPinned_;
+};
+
+} // namespace mymuduo
+
+#endif // MYMUDUO_NET_BUFFERCHAIN_H
@@ -0,0 +1,136 @@
+#include "src/net/BufferPool.h"
+#include "src/logger/Logging.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace mymuduo;
+
+BufferPool::Stats::Stats()
+    : inUseBlocks(0), inUseBytes(0), cachedBlocks(0), cachedBytes(0),
+      allocations(0), hits(0), trimmedBytes(0) {}
+
+void BufferPool::Stats::merge(const Stats &other) {
+  inUseBlocks += other.inUseBlocks;
+  inUseBytes += other.inUseBytes;
+  cachedBlocks += other.cachedBlocks;
+  cachedBytes += other.cachedBytes;
+  allocations += other.allocations;
+  hits += other.hits;
+  trimmedBytes += other.trimmedBytes;
+}
+
+std::string BufferPool::Stats::toString() const {
+  char buf[256];
+  snprintf(buf, sizeof buf,
+           "inUse=%llu blocks/%llu bytes cached=%llu blocks/%llu bytes "
+           "allocations=%llu hits=%llu trimmed=%llu bytes",
+           static_cast<unsigned long long>(inUseBlocks),
+           static_cast<unsigned long long>(inUseBytes),
+           static_cast<unsigned long long>(cachedBlocks),
+           static_cast<unsigned long long>(cachedBytes),
+           static_cast<unsigned long long>(allocations),
+           static_cast<unsigned long long>(hits),
+           static_cast<unsigned long long>(trimmedBytes));
+  return buf;
+}
+
+BufferPool::BufferPool()
+    : owner_(std::this_thread::get_id()),
+      maxCachedBytes_(kDefaultMaxCachedBytes), freeLists_(), inUseBlocks_(0),
+      inUseBytes_(0), cachedBlocks_(0), cachedBytes_(0), allocations_(0),
+      hits_(0), trimmedBytes_(0) {}
+
+BufferPool::~BufferPool() {
+  for (FreeList &list : freeLists_) {
+    while (list.head != nullptr) {
+      FreeBlock *block = list.head;
+      list.head = block->next;
+      ::free(block);
+    }
+  }
+}
+
+char *BufferPool::allocate(size_t *size) {
+  const int cls = classOf(*size);
+  if (cls < kNumClasses) {
+    *size = kMinBlockSize << cls;
+  }
+  inUseBlocks_.fetch_add(1, std::memory_order_relaxed);
+  inUseBytes_.fetch_add(*size, std::memory_order_relaxed);
+  if (!isOwnerThread()) {
+    char *block = static_cast<char *>(::malloc(*size));
+    if (block == nullptr) {
+      LOG_FATAL << "BufferPool::allocate() out of memory";
+    }
+    return block;
+  }
+
+  increment(&allocations_, 1);
+  if (cls < kNumClasses && freeLists_[cls].head != nullptr) {
+    FreeList &list = freeLists_[cls];
+    FreeBlock *block = list.head;
+    list.head = block->next;
+    if (--list.count < list.lowWater) {
+      list.lowWater = list.count;
+    }
+    increment(&hits_, 1);
+    increment(&cachedBlocks_, -1);
+    increment(&cachedBytes_, -static_cast<int64_t>(*size));
+    return reinterpret_cast<char *>(block);
+  }
+
+  char *block = static_cast<char *>(::malloc(*size));
+  if (block == nullptr) {
+    LOG_FATAL << "BufferPool::allocate() out of memory";
+  }
+  return block;
+}
+
+void BufferPool::deallocate(char *block, size_t size) {
+  inUseBlocks_.fetch_sub(1, std::memory_order_relaxed);
+  inUseBytes_.fetch_sub(size, std::memory_order_relaxed);
+  const int cls = classOf(size);
+  if (cls >= kNumClasses || !isOwnerThread() ||
+      cachedBytes_.load(std::memory_order_relaxed) + size > maxCachedBytes_) {
+    ::free(block);
+    return;
+  }
+
+  FreeList &list = freeLists_[cls];
+  FreeBlock *freeBlock = reinterpret_cast<FreeBlock *>(block);
+  freeBlock->next = list.head;
+  list.head = freeBlock;
+  ++list.count;
+  increment(&cachedBlocks_, 1);
+  increment(&cachedBytes_, size);
+}
+
+void BufferPool::trim() {
+  for (int cls = 0; cls < kNumClasses; ++cls) {
+    FreeList &list = freeLists_[cls];
+    const size_t size = kMinBlockSize << cls;
+    for (size_t i = 0; i < list.lowWater; ++i) {
+      FreeBlock *block = list.head;
+      list.head = block->next;
+      ::free(block);
+    }
+    list.count -= list.lowWater;
+    increment(&cachedBlocks_, -static_cast<int64_t>(list.lowWater));
+    increment(&cachedBytes_, -static_cast<int64_t>(list.lowWater * size));
+    increment(&trimmedBytes_, list.lowWater * size);
+    list.lowWater = list.count;
+  }
+}
+
+BufferPool::Stats BufferPool::stats() const {
+  Stats stats;
+  stats.inUseBlocks = inUseBlocks_.load(std::memory_order_relaxed);
+  stats.inUseBytes = inUseBytes_.load(std::memory_order_relaxed);
+  stats.cachedBlocks = cachedBlocks_.load(std::memory_order_relaxed);
+  stats.cachedBytes = cachedBytes_.load(std::memory_order_relaxed);
+  stats.allocations = allocations_.load(std::memory_order_relaxed);
+  stats.hits = hits_.load(std::memory_order_relaxed);
+  stats.trimmedBytes = trimmedBytes_.load(std::memory_order_relaxed);
+  return stats;
+}
@@ -0,0 +1,114 @@
+#ifndef MYMUDUO_NET_BUFFERPOOL_H
+#define MYMUDUO_NET_BUFFERPOOL_H
+
+#include "src/base/noncopyable.h"
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <thread>
+
+namespace mymuduo {
+
+/**
+ * 每个EventLoop一个的缓冲区内存池，供Buffer和BufferChain使用
+ * 内存块按2的幂分为1KB~256KB共9级，每级一条空闲链表，更大的请求直接malloc/free。
+ * 连接只在有待处理的数据时借用内存，缓冲区清空后立即归还，空闲连接不占缓冲区内存。
+ *
+ * 收缩策略：
+ *  - 缓存的空闲块总共不超过maxCachedBytes，超出的部分直接还给系统；
+ *  - EventLoop定期调用trim()，每一级中在上一个周期里始终没有被借出的空闲块还给系统，
+ *    流量高峰过去一两个周期后缓存回落到实际需要的大小。
+ *
+ * allocate/deallocate应在loop线程调用；在其他线程调用时不经过空闲链表，直接malloc/free。
+ * stats()可以在任意线程调用。
+ */
+class BufferPool : noncopyable {
+public:
+  static const size_t kMinBlockSize = 1024;
+  static const int kNumClasses = 9;
+  static const size_t kMaxBlockSize = kMinBlockSize << (kNumClasses - 1);
+  static const size_t kDefaultMaxCachedBytes = 16 * 1024 * 1024;
+
+  struct Stats {
+    Stats();
+    void merge(const Stats &other);
+    std::string toString() const;
+
+    uint64_t inUseBlocks;  // 借出未还的块数
+    uint64_t inUseBytes;
+    uint64_t cachedBlocks; // 缓存的空闲块数
+    uint64_t cachedBytes;
+    uint64_t allocations;  // allocate的次数
+    uint64_t hits;         // 其中由缓存满足的次数
+    uint64_t trimmedBytes; // trim()累计还给系统的字节数
+  };
+
+  BufferPool();
+  ~BufferPool();
+
+  // 分配至少*size字节，*size改为实际分配的大小
+  char *allocate(size_t *size);
+  // size必须是allocate返回的实际大小
+  void deallocate(char *block, size_t size);
+  // 块的内存都是malloc的，可以在池之间(或与不用池的使用者之间)直接转移，只需转移借出计数：
+  // 转入的块计入本池，之后由deallocate归还；disown后块由调用者用free或交给别的池。
+  // 可以在任意线程调用
+  void adopt(size_t size) {
+    inUseBlocks_.fetch_add(1, std::memory_order_relaxed);
+    inUseBytes_.fetch_add(size, std::memory_order_relaxed);
+  }
+  void disown(size_t size) {
+    inUseBlocks_.fetch_sub(1, std::memory_order_relaxed);
+    inUseBytes_.fetch_sub(size, std::memory_order_relaxed);
+  }
+
+  // 释放上一次trim()以来一直空闲的缓存块，由EventLoop定期调用
+  void trim();
+
+  void setMaxCachedBytes(size_t bytes) { maxCachedBytes_ = bytes; }
+
+  Stats stats() const;
+
+private:
+  struct FreeBlock {
+    FreeBlock *next;
+  };
+  struct FreeList {
+    FreeBlock *head;
+    size_t count;
+    size_t lowWater; // 上一次trim()以来count的最小值
+  };
+
+  // 容纳size字节的级别，超过kMaxBlockSize时返回kNumClasses
+  static int classOf(size_t size) {
+    if (size <= kMinBlockSize) {
+      return 0;
+    }
+    return 64 - __builtin_clzll((size - 1) / kMinBlockSize);
+  }
+
+  static void increment(std::atomic<uint64_t> *counter, int64_t n) {
+    counter->store(counter->load(std::memory_order_relaxed) + n,
+                   std::memory_order_relaxed);
+  }
+
+  bool isOwnerThread() const { return owner_ == std::this_thread::get_id(); }
+
+  const std::thread::id owner_;
+  size_t maxCachedBytes_;
+  FreeList freeLists_[kNumClasses];
+  // inUse*可能由其他线程修改，其余只由loop线程写
+  std::atomic<uint64_t> inUseBlocks_;
+  std::atomic<uint64_t> inUseBytes_;
+  std::atomic<uint64_t> cachedBlocks_;
+  std::atomic<uint64_t> cachedBytes_;
+  std::atomic<uint64_t> allocations_;
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> trimmedBytes_;
+};
+
+} // namespace mymuduo
+
+#endif // MYMUDUO_NET_BUFFERPOOL_H
@@ -16,6 +16,8 @@ using CloseCallback = std::function<void(const TcpConnectionPtr &)>;
 using WriteCompleteCallback = std::function<void(const TcpConnectionPtr &)>;
 using HighWaterMarkCallback =
     std::function<void(const TcpConnectionPtr &, size_t)>;
+using LowWaterMarkCallback =
+    std::function<void(const TcpConnectionPtr &, size_t)>;
 
 using MessageCallback =
     std::function<void(const TcpConnectionPtr &, Buffer *, Timestamp)>;
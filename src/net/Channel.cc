@@ -11,7 +11,8 @@ const int Channel::kWriteEvent = POLLOUT;
 
 Channel::Channel(EventLoop *loop, int fd)
     : loop_(loop), fd_(fd), events_(0), revents_(0), index_(-1),
-      addedToLoop_(false), eventHandling_(false), tied_(false) {}
+      addedToLoop_(false), eventHandling_(false), edgeTriggered_(false),
+      tied_(false) {}
 
 Channel::~Channel() {
   assert(!addedToLoop_);
@@ -1,6 +1,7 @@
 #ifndef MYMUDUO_NET_CHANNEL_H
 #define MYMUDUO_NET_CHANNEL_H
 
+#include <assert.h>
 #include <functional>
 #include <memory>
 #include <sys/epoll.h>
@@ -44,13 +45,21 @@ public:
     events_ &= ~kReadEvent;
     update();
   }
+  // ET模式下只要还关注任何事件，注册时就已经包含了EPOLLOUT，切换写事件不需要epoll_ctl；
+  // 但读写都关闭后channel已从epoll删除(或以空事件注册)，再打开写事件时必须重新注册
   void enableWriting() {
+    int registered = pollEvents();
     events_ |= kWriteEvent;
-    update();
+    if (pollEvents() != registered) {
+      update();
+    }
   }
   void disableWriting() {
+    int registered = pollEvents();
     events_ &= ~kWriteEvent;
-    update();
+    if (pollEvents() != registered) {
+      update();
+    }
   }
   void disableAll() {
     events_ &= kNoneEvent;
@@ -62,6 +71,20 @@ public:
   bool isWriting() const { return events_ & kWriteEvent; }
   bool isReading() const { return events_ & kReadEvent; }
 
+  // 边缘触发模式，需要在channel注册到Poller之前设置
+  void setEdgeTriggered(bool on) {
+    assert(index_ == -1);
+    edgeTriggered_ = on;
+  }
+  bool isEdgeTriggered() const { return edgeTriggered_; }
+  // 实际注册到epoll的事件，ET模式下一次性注册读写事件
+  int pollEvents() const {
+    if (edgeTriggered_ && events_ != kNoneEvent) {
+      return events_ | kWriteEvent | EPOLLET;
+    }
+    return events_;
+  }
+
   int index() { return index_; }
   void set_index(int idx) { index_ = idx; }
 
@@ -90,6 +113,7 @@ private:
   int index_;       // 在Poller上注册的情况
   bool addedToLoop_;
   bool eventHandling_;
+  bool edgeTriggered_; // 是否以EPOLLET注册
   // 弱指针指向TcpConnection(必要时升级为shared_ptr多一份引用计数，避免用户误删)
   std::weak_ptr<void> tie_;
   // 标志此 Channel 是否被调用过 Channel::tie 方法
@@ -1,5 +1,7 @@
 #include "src/net/Poller.h"
 #include "src/net/EPollPoller.h"
+#include "src/net/IoUringPoller.h"
+#include "src/logger/Logging.h"
 #include <cstdlib>
 
 using namespace mymuduo;
@@ -7,6 +9,12 @@ using namespace mymuduo;
 Poller* Poller::newDefaultPoller(EventLoop *loop) {
   if (::getenv("MUDUO_USE_POLL")) {
     return nullptr;
+  } else if (::getenv("MUDUO_USE_IO_URING")) {
+    if (IoUringPoller::isSupported()) {
+      return new IoUringPoller(loop);
+    }
+    LOG_WARN << "io_uring is not supported by the kernel, fall back to epoll";
+    return new EPollPoller(loop);
   } else {
     return new EPollPoller(loop);
   }
@@ -23,7 +23,7 @@ EPollPoller::EPollPoller(EventLoop *loop)
 EPollPoller::~EPollPoller() { ::close(epollfd_); }
 
 Timestamp EPollPoller::poll(int timeoutMs, ChannelList *activeChannels) {
-  LOG_TRACE << "fd total count " << channels_.size();
+  LOG_TRACE << "fd total count " << numChannels();
   int numEvents = ::epoll_wait(epollfd_, &*events_.begin(),
                                static_cast<int>(events_.size()), timeoutMs);
   int savedErrno = errno;
@@ -51,9 +51,7 @@ void EPollPoller::fillActiveChannels(int numEvents,
   assert(static_cast<size_t>(numEvents) <= events_.size());
   for (int i = 0; i < numEvents; ++i) {
     Channel *channel = static_cast<Channel *>(events_[i].data.ptr);
-    auto it = channels_.find(channel->fd());
-    assert(it != channels_.end());
-    assert(it->second == channel);
+    assert(findChannel(channel->fd()) == channel);
     channel->set_revents(events_[i].events);
     activeChannels->push_back(channel);
   }
@@ -64,23 +62,18 @@ void EPollPoller::updateChannel(Channel *channel) {
   const int index = channel->index();
   if (index == kNew || index == kDeleted) {
     // a new one, add with EPOLL_CTL_ADD
-    int fd = channel->fd();
     if (index == kNew) {
-      assert(channels_.find(fd) == channels_.end());
-      channels_[fd] = channel;
+      addChannel(channel);
     }
     else {
-      assert(channels_.find(fd) != channels_.end());
-      assert(channels_[fd] == channel);
+      assert(findChannel(channel->fd()) == channel);
     }
     channel->set_index(kAdded);
     update(EPOLL_CTL_ADD, channel);
   }
   else {
     // update existed one with EPOLL_CTL_MOD/DEL
-    int fd = channel->fd();
-    assert(channels_.find(fd) != channels_.end());
-    assert(channels_[fd] == channel);
+    assert(findChannel(channel->fd()) == channel);
     assert(index == kAdded);
     if (channel->isNoneEvent()) {
       update(EPOLL_CTL_DEL, channel);
@@ -94,14 +87,12 @@ void EPollPoller::updateChannel(Channel *channel) {
 
 void EPollPoller::removeChannel(Channel *channel) {
   assertInLoopThread();
-  int fd = channel->fd();
-  assert(channels_.find(fd) != channels_.end());
-  assert(channels_[fd] == channel);
+  assert(findChannel(channel->fd()) == channel);
   assert(channel->isNoneEvent());
   int index = channel->index();
   assert(index == kAdded || index == kDeleted);
 
-  assert(channels_.erase(fd) == 1);
+  eraseChannel(channel);
   if (index == kAdded) {
     update(EPOLL_CTL_DEL, channel);
   }
@@ -111,7 +102,7 @@ void EPollPoller::removeChannel(Channel *channel) {
 void EPollPoller::update(int operation, Channel *channel) {
   epoll_event event;
   memset(&event, 0, sizeof event);
-  event.events = channel->events();
+  event.events = channel->pollEvents();
   event.data.ptr = channel;
   int fd = channel->fd();
   if (::epoll_ctl(epollfd_, operation, fd, &event) < 0) {
@@ -13,6 +13,7 @@ public:
   Timestamp poll(int timeoutMs, ChannelList* activeChannels) override;
   void updateChannel(Channel* channel) override;
   void removeChannel(Channel* channel) override;
+  bool supportsEdgeTriggered() const override { return true; }
 
 private:
   // 填写活跃的连接
@@ -1,11 +1,15 @@
 #include "src/net/EventLoop.h"
 #include "TimerQueue.h"
 #include "src/logger/Logging.h"
+#include "src/net/BufferChain.h"
 #include "src/net/Channel.h"
 #include "src/net/Poller.h"
+#include "src/net/TcpConnection.h"
 #include "src/base/CurrentThread.h"
 
+#include <string.h>
 #include <sys/eventfd.h>
+#include <sys/socket.h>
 #include <unistd.h>
 #include <algorithm>
 
@@ -15,6 +19,15 @@ thread_local EventLoop *t_loopInThisThread = nullptr;
 
 // default poller timeout value
 const int kPollTimeMs = 10000;
+// busy poll自旋窗口的下限为上限的1/kBusyPollShrinkLimit
+const int kBusyPollShrinkLimit = 16;
+// 每隔这么久把BufferPool中一直空闲的缓存还给系统
+const int64_t kBufferPoolTrimIntervalNs = 10LL * 1000 * 1000 * 1000;
+// 每隔这么久检查一次已关闭连接的MSG_ZEROCOPY完成通知
+const double kZeroCopyReapInterval = 0.1;
+// 关闭后这么久对端还没确认完数据就断开连接，内核丢弃发送队列后会补上完成通知；
+// 断开后再等这么久还没有就放弃这些块
+const int64_t kZeroCopyLingerNs = 60LL * 1000 * 1000 * 1000;
 
 // create wakeup fd to notify subReactor's channel
 static int createEventFd() {
@@ -35,9 +48,12 @@ uint64_t EventLoop::getThreadId() {
 EventLoop::EventLoop()
     : looping_(false), quit_(false), eventHandling_(false),
       callingPendingFunctors_(false), threadId_(std::this_thread::get_id()),
+      busyPollMaxUs_(0), busyPollUs_(0),
       poller_(Poller::newDefaultPoller(this)),
-      timerQueue_(new TimerQueue(this)), wakeupFd_(createEventFd()),
-      wakeupChannel_(new Channel(this, wakeupFd_)) {
+      timerQueue_(TimerQueue::newDefaultTimerQueue(this)), wakeupFd_(createEventFd()),
+      wakeupPending_(false), wakeupsIssued_(0), wakeupsSkipped_(0), numConnections_(0),
+      wakeupChannel_(new Channel(this, wakeupFd_)),
+      lastTrimNs_(EventLoopStats::nowNs()) {
   LOG_DEBUG << "EventLoop created " << this << " in thread " << getThreadId();
   if (t_loopInThisThread) {
     LOG_FATAL << "Another EventLoop " << t_loopInThisThread
@@ -58,6 +74,11 @@ EventLoop::~EventLoop() {
   wakeupChannel_->disableAll();
   wakeupChannel_->remove();
   ::close(wakeupFd_);
+  // bufferPool_要析构了，还没完成的块只能泄漏，见BufferChain::~BufferChain
+  for (ZeroCopyGrave &grave : zeroCopyGraveyard_) {
+    ::close(grave.fd);
+  }
+  zeroCopyGraveyard_.clear();
   t_loopInThisThread = nullptr;
 }
 
@@ -73,11 +94,21 @@ void EventLoop::loop() {
 
   LOG_TRACE << "EventLoop " << this << " start looping";
 
+  int64_t iterationStart = EventLoopStats::nowNs();
   while (!quit_.load()) {
     // 清空activeChannels_
     activeChannels_.clear();
     // 获取
-    pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+    if (busyPollMaxUs_ > 0) {
+      pollReturnTime_ = busyPoll();
+    } else {
+      pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+    }
+    // loop已经醒来，本轮末尾的doPendingFunctors会处理期间投递的回调
+    wakeupPending_.store(true, std::memory_order_release);
+    const int64_t pollEnd = EventLoopStats::nowNs();
+    stats_.pollTime.record(pollEnd - iterationStart);
+    stats_.activeChannels.record(activeChannels_.size());
     if (Logger::LogLevel() <= Logger::TRACE) {
       printActiveChannels();
     }
@@ -86,13 +117,54 @@ void EventLoop::loop() {
       channel->handleEvent(pollReturnTime_);
     }
     eventHandling_ = false;
+    const int64_t handleEnd = EventLoopStats::nowNs();
+    stats_.handleEventTime.record(handleEnd - pollEnd);
     // 执行当前EventLoop事件循环需要处理的回调操作
-    doPendingFunctors();
+    const size_t numFunctors = doPendingFunctors();
+    iterationStart = EventLoopStats::nowNs();
+    stats_.pendingFunctorTime.record(iterationStart - handleEnd);
+    stats_.pendingFunctors.record(numFunctors);
+    if (iterationStart - lastTrimNs_ >= kBufferPoolTrimIntervalNs) {
+      bufferPool_.trim();
+      lastTrimNs_ = iterationStart;
+    }
   }
   LOG_TRACE << "EventLoop " << this << " stop looping";
   looping_.store(false);
 }
 
+void EventLoop::setBusyPoll(int maxSpinUs) {
+  assertInLoopThread();
+  busyPollMaxUs_ = std::max(maxSpinUs, 0);
+  busyPollUs_ = busyPollMaxUs_;
+}
+
+Timestamp EventLoop::busyPoll() {
+  // 自旋期间loop一直醒着，生产者不需要写eventfd
+  wakeupPending_.store(true, std::memory_order_release);
+  Timestamp start(Timestamp::now());
+  const int64_t deadline = start.microSecondsSinceEpoch() + busyPollUs_;
+  const int minSpinUs = std::max(busyPollMaxUs_ / kBusyPollShrinkLimit, 1);
+  Timestamp now;
+  do {
+    now = poller_->poll(0, &activeChannels_);
+    if (!activeChannels_.empty() || !pendingFunctors_.empty()) {
+      // 自旋等到了事件，说明事件比较密集，扩大窗口
+      busyPollUs_ = std::min(busyPollUs_ * 2, busyPollMaxUs_);
+      return now;
+    }
+  } while (now.microSecondsSinceEpoch() < deadline && !quit_.load());
+
+  // 空转了一整个窗口，缩小窗口减少CPU浪费
+  busyPollUs_ = std::max(busyPollUs_ / 2, minSpinUs);
+  // 阻塞前清除标志并再检查一次，之后投递的回调会写eventfd唤醒阻塞的poll
+  wakeupPending_.exchange(false, std::memory_order_acq_rel);
+  if (!pendingFunctors_.empty() || quit_.load()) {
+    return poller_->poll(0, &activeChannels_);
+  }
+  return poller_->poll(kPollTimeMs, &activeChannels_);
+}
+
 void EventLoop::quit() {
   quit_.store(true);
   if (!isInLoopThread()) {
@@ -109,10 +181,7 @@ void EventLoop::runInLoop(Functor cb) {
 }
 
 void EventLoop::queueInLoop(Functor cb) {
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    pendingFunctors_.emplace_back(std::move(cb));
-  }
+  pendingFunctors_.push(std::move(cb));
 
   if (!isInLoopThread() || callingPendingFunctors_.load()) {
     wakeup();
@@ -120,6 +189,13 @@ void EventLoop::queueInLoop(Functor cb) {
 }
 
 void EventLoop::wakeup() {
+  // 和doPendingFunctors中的exchange(false)配对：读到true说明loop之后一定会
+  // 清除标志并重新检查pendingFunctors_，本次投递不会被遗漏
+  if (wakeupPending_.exchange(true, std::memory_order_acq_rel)) {
+    wakeupsSkipped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  wakeupsIssued_.fetch_add(1, std::memory_order_relaxed);
   uint64_t one = 1;
   ssize_t n = ::write(wakeupFd_, &one, sizeof one);
   if (n != sizeof one) {
@@ -143,6 +219,21 @@ TimerId EventLoop::runEvery(double interval, TimerCallback cb) {
 
 void EventLoop::cancel(TimerId timerId) { return timerQueue_->cancel(timerId); }
 
+void EventLoop::setTimingWheel(bool on) {
+  assertInLoopThread();
+  const TimerQueue::Type type =
+      on ? TimerQueue::kTimingWheel : TimerQueue::kSorted;
+  if (timerQueue_->type() == type) {
+    return;
+  }
+  if (timerQueue_->size() > 0) {
+    LOG_ERROR << "EventLoop::setTimingWheel() - " << timerQueue_->size()
+              << " timers pending, keep the current timer queue";
+    return;
+  }
+  timerQueue_.reset(TimerQueue::newTimerQueue(this, type));
+}
+
 void EventLoop::updateChannel(Channel *channel) {
   assert(channel->ownerLoop() == this);
   assertInLoopThread();
@@ -165,6 +256,10 @@ bool EventLoop::hasChannel(Channel *channel) {
   return poller_->hasChannel(channel);
 }
 
+bool EventLoop::supportsEdgeTriggered() const {
+  return poller_->supportsEdgeTriggered();
+}
+
 void EventLoop::abortNotInLoopThread() {
   LOG_FATAL << "EventLoop " << this << " was created in tid " 
             << getThreadId() << ", current thread id = " << CurrentThread::get_id();
@@ -178,20 +273,80 @@ void EventLoop::handleRead() {
   }
 }
 
-void EventLoop::doPendingFunctors() {
-  std::vector<Functor> functors;
+size_t EventLoop::doPendingFunctors() {
   callingPendingFunctors_.store(true);
+  // 先清除标志再取回调，之后投递的回调会重新写eventfd
+  wakeupPending_.exchange(false, std::memory_order_acq_rel);
 
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    functors.swap(pendingFunctors_);
+  // 与原来swap整个vector一致，执行期间新入队的回调留到下一轮
+  size_t n = pendingFunctors_.consume([](Functor &functor) { functor(); });
+  // 事件处理和回调中send的数据都已经攒好；仍在callingPendingFunctors_期间，
+  // 发送完成的回调等会唤醒loop，不会拖到下一次poll返回
+  if (!dirtyConnections_.empty()) {
+    flushConnections();
   }
 
-  for (const Functor &functor : functors) {
-    functor();
+  callingPendingFunctors_.store(false);
+  return n;
+}
+
+void EventLoop::adoptZeroCopyChain(int fd, std::unique_ptr<BufferChain> chain) {
+  assertInLoopThread();
+  // 原来的fd关闭时不会再发FIN，由这里发出；排队的数据仍会先发完
+  ::shutdown(fd, SHUT_WR);
+  if (zeroCopyGraveyard_.empty()) {
+    runAfter(kZeroCopyReapInterval, [this] { reapZeroCopyGraveyard(); });
   }
+  zeroCopyGraveyard_.push_back(ZeroCopyGrave{
+      fd, std::move(chain), EventLoopStats::nowNs() + kZeroCopyLingerNs, false});
+}
 
-  callingPendingFunctors_.store(false);
+void EventLoop::reapZeroCopyGraveyard() {
+  const int64_t now = EventLoopStats::nowNs();
+  std::vector<ZeroCopyGrave> graves;
+  graves.swap(zeroCopyGraveyard_);
+  for (ZeroCopyGrave &grave : graves) {
+    grave.chain->readZeroCopyCompletions(grave.fd);
+    if (grave.chain->numPinnedBlocks() > 0 && now >= grave.deadlineNs) {
+      if (!grave.aborted) {
+        // 对端迟迟不确认：断开连接(发RST)让内核清空发送队列，但保留fd读剩下的通知
+        struct sockaddr addr;
+        memset(&addr, 0, sizeof addr);
+        addr.sa_family = AF_UNSPEC;
+        ::connect(grave.fd, &addr, sizeof addr);
+        grave.aborted = true;
+        grave.deadlineNs = now + kZeroCopyLingerNs;
+        grave.chain->readZeroCopyCompletions(grave.fd);
+      } else {
+        LOG_WARN << "EventLoop::reapZeroCopyGraveyard() gives up waiting for "
+                 << "MSG_ZEROCOPY completions on fd " << grave.fd;
+        ::close(grave.fd);
+        continue; // chain析构时泄漏剩下的块
+      }
+    }
+    if (grave.chain->numPinnedBlocks() == 0) {
+      ::close(grave.fd);
+    } else {
+      zeroCopyGraveyard_.push_back(std::move(grave));
+    }
+  }
+  if (!zeroCopyGraveyard_.empty()) {
+    runAfter(kZeroCopyReapInterval, [this] { reapZeroCopyGraveyard(); });
+  }
+}
+
+void EventLoop::queueFlush(TcpConnectionPtr conn) {
+  assertInLoopThread();
+  dirtyConnections_.push_back(std::move(conn));
+}
+
+void EventLoop::flushConnections() {
+  // flushOutput不会再登记连接，交换是为了复用两个vector的空间
+  flushingConnections_.swap(dirtyConnections_);
+  for (const TcpConnectionPtr &conn : flushingConnections_) {
+    conn->flushOutput();
+  }
+  flushingConnections_.clear();
 }
 void EventLoop::printActiveChannels() const {
   for (const Channel *channel : activeChannels_) {
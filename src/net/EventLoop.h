@@ -3,17 +3,20 @@
 
 #include <atomic>
 #include <functional>
-#include <mutex>
 #include <vector>
 #include <thread>
 #include <src/base/Thread.h>
+#include "src/base/MpscQueue.h"
 #include "src/base/Timestamp.h"
 #include "src/base/noncopyable.h"
+#include "src/net/BufferPool.h"
 #include "src/net/Callbacks.h"
+#include "src/net/EventLoopStats.h"
 #include "src/net/TimerId.h"
 
 namespace mymuduo {
 
+class BufferChain;
 class Channel;
 class Poller;
 class TimerQueue;
@@ -39,11 +42,43 @@ public:
   void queueInLoop(Functor cb);
 
   // 用来唤醒该loop所在的线程
+  // loop已经醒着或已有唤醒在途时不会重复写eventfd
   void wakeup();
 
+  // 实际写eventfd的唤醒次数 / 被合并掉的唤醒次数
+  uint64_t wakeupsIssued() const { return wakeupsIssued_.load(); }
+  uint64_t wakeupsSkipped() const { return wakeupsSkipped_.load(); }
+
+  // 每轮循环的耗时/活跃channel数/回调数等统计，可以在任意线程调用
+  EventLoopStats::Snapshot stats() const { return stats_.snapshot(); }
+  // 供TcpConnection等记录统计，只在loop线程使用
+  EventLoopStats *mutableStats() { return &stats_; }
+  // 累计处理事件和回调的时间，见EventLoopStats::busyNs
+  uint64_t busyNs() const { return stats_.busyNs(); }
+  // 属于本loop的TcpConnection个数(从创建到connectDestroyed)，LoopSelector据此选择loop，可以在任意线程调用
+  int numConnections() const {
+    return numConnections_.load(std::memory_order_relaxed);
+  }
+
+  // 本loop上连接的Buffer/BufferChain借用的内存池，只在loop线程使用，
+  // stats()可以在任意线程调用
+  BufferPool *bufferPool() { return &bufferPool_; }
+  // 接管关闭时还有MSG_ZEROCOPY发送未完成的输出缓冲区，只在loop线程调用。
+  // fd是连接socket的dup，保留它才能继续读到完成通知；通知全部到达后块才回到
+  // bufferPool_，然后关闭fd
+  void adoptZeroCopyChain(int fd, std::unique_ptr<BufferChain> chain);
+
   // Time when poll returns, usually means data arrivial.
   Timestamp pollReturnTime() const { return pollReturnTime_; }
 
+  // 低延迟模式：阻塞前先以0超时poll并检查pendingFunctors_，最多自旋maxSpinUs微秒，
+  // 自旋窗口根据最近是否在自旋期间等到事件自适应伸缩，0表示关闭。
+  // 新连接会同时设置SO_BUSY_POLL。需要在loop线程调用，一般在ThreadInitCallback中设置
+  void setBusyPoll(int maxSpinUs);
+  int busyPollMaxUs() const { return busyPollMaxUs_; }
+  // 当前的自旋窗口
+  int busyPollUs() const { return busyPollUs_; }
+
   // Runs callback at 'time'.
   TimerId runAt(Timestamp time, TimerCallback cb);
   // Runs callback after @c delay seconds.
@@ -53,10 +88,22 @@ public:
 
   void cancel(TimerId timerId);
 
+  // 开启自动合并发送的连接(TcpConnection::setAutoCork)在本轮第一次有数据待发送时登记，
+  // 本轮doPendingFunctors之后统一调用TcpConnection::flushOutput，只在loop线程调用
+  void queueFlush(TcpConnectionPtr conn);
+
+  // 定时器改用分层时间轮(精度1毫秒，增删O(1))，适合每个连接都有超时定时器的场景。
+  // 需要在loop线程、添加任何定时器之前调用，一般在ThreadInitCallback中设置
+  void setTimingWheel(bool on);
+
   // internal use only
   void updateChannel(Channel *channel);
   void removeChannel(Channel *channel);
   bool hasChannel(Channel *channel);
+  bool supportsEdgeTriggered() const;
+  void updateConnectionCount(int delta) {
+    numConnections_.fetch_add(delta, std::memory_order_relaxed);
+  }
 
   void assertInLoopThread() {
     if (!isInLoopThread()) {
@@ -73,11 +120,21 @@ public:
 private:
   void abortNotInLoopThread();
   void handleRead(); // waked up
-  void doPendingFunctors(); // callback
+  size_t doPendingFunctors(); // callback, 返回执行的回调数
+  void flushConnections();
   void printActiveChannels() const;
+  Timestamp busyPoll(); // 自旋一段时间后再阻塞的poll
+  // 读出墓地中各个socket的完成通知，释放已经完成的，还有剩下的就稍后再来
+  void reapZeroCopyGraveyard();
 
 private:
   using ChannelList = std::vector<Channel *>;
+  struct ZeroCopyGrave {
+    int fd;
+    std::unique_ptr<BufferChain> chain;
+    int64_t deadlineNs; // 超时后先断开连接，再超时就放弃这些块
+    bool aborted;
+  };
 
   std::atomic_bool looping_;                // atomic
   std::atomic_bool quit_;                   // 退出事件循环flag
@@ -85,14 +142,28 @@ private:
   std::atomic_bool callingPendingFunctors_; // 当前loop是否有需要执行的回调操作
   const std::thread::id threadId_; // 记录当前loop所在线程的id
   Timestamp pollReturnTime_;
+  int busyPollMaxUs_; // 最大自旋时间，0表示不自旋
+  int busyPollUs_;    // 自适应的自旋时间
   std::unique_ptr<Poller> poller_;
   std::unique_ptr<TimerQueue> timerQueue_;
   int wakeupFd_;
+  // 为true表示loop一定会在阻塞前再执行一次doPendingFunctors()：
+  // poll返回后到doPendingFunctors开始前，或者已有人写了eventfd
+  std::atomic_bool wakeupPending_;
+  alignas(64) std::atomic<uint64_t> wakeupsIssued_;
+  std::atomic<uint64_t> wakeupsSkipped_;
+  std::atomic<int> numConnections_;
   // 用于处理wakeupFd_上的可读事件，将事件分发给handleRead
   std::unique_ptr<Channel> wakeupChannel_;
   ChannelList activeChannels_; // 活跃的channel
-  std::mutex mutex_;           // 用于保护pendingFunctors_线程安全操作
-  std::vector<Functor> pendingFunctors_; // 存储loop跨线程需要执行的所有回调操作
+  EventLoopStats stats_;
+  BufferPool bufferPool_;
+  int64_t lastTrimNs_; // 上一次bufferPool_.trim()的时间
+  std::vector<ZeroCopyGrave> zeroCopyGraveyard_; // 等待MSG_ZEROCOPY完成通知的已关闭连接
+  std::vector<TcpConnectionPtr> dirtyConnections_; // 等待本轮末尾发送的连接
+  std::vector<TcpConnectionPtr> flushingConnections_;
+  // 存储loop跨线程需要执行的所有回调操作，多个线程无锁入队，只由loop线程出队
+  MpscQueue<Functor> pendingFunctors_;
 };
 
 } // namespace mymuduo
@@ -0,0 +1,121 @@
+#include "src/net/EventLoopStats.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+using namespace mymuduo;
+
+Histogram::Snapshot::Snapshot() : count(0), sum(0), max(0), buckets() {}
+
+void Histogram::Snapshot::merge(const Snapshot &other) {
+  count += other.count;
+  sum += other.sum;
+  max = std::max(max, other.max);
+  for (int i = 0; i < kNumBuckets; ++i) {
+    buckets[i] += other.buckets[i];
+  }
+}
+
+double Histogram::Snapshot::mean() const {
+  return count == 0 ? 0 : static_cast<double>(sum) / count;
+}
+
+uint64_t Histogram::Snapshot::percentile(double p) const {
+  // 快照的各个计数不是同一时刻读取的，以桶的总数为准
+  uint64_t total = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    total += buckets[i];
+  }
+  if (total == 0) {
+    return 0;
+  }
+  const uint64_t rank = static_cast<uint64_t>(p * (total - 1)) + 1;
+  uint64_t seen = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      // 第i个桶的上界是2^i - 1，不超过实际的最大值
+      if (i == kNumBuckets - 1) {
+        return max;
+      }
+      return std::min((static_cast<uint64_t>(1) << i) - 1, max);
+    }
+  }
+  return max;
+}
+
+std::string Histogram::Snapshot::toString() const {
+  char buf[128];
+  snprintf(buf, sizeof buf, "count=%llu mean=%.1f p50=%llu p99=%llu max=%llu",
+           static_cast<unsigned long long>(count), mean(),
+           static_cast<unsigned long long>(percentile(0.5)),
+           static_cast<unsigned long long>(percentile(0.99)),
+           static_cast<unsigned long long>(max));
+  return buf;
+}
+
+Histogram::Histogram() : count_(0), sum_(0), max_(0) {
+  for (std::atomic<uint64_t> &bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+  Snapshot snap;
+  snap.count = count_.load(std::memory_order_relaxed);
+  snap.sum = sum_.load(std::memory_order_relaxed);
+  snap.max = max_.load(std::memory_order_relaxed);
+  for (int i = 0; i < kNumBuckets; ++i) {
+    snap.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+  }
+  return snap;
+}
+
+void EventLoopStats::Snapshot::merge(const Snapshot &other) {
+  iterations += other.iterations;
+  pollTime.merge(other.pollTime);
+  activeChannels.merge(other.activeChannels);
+  handleEventTime.merge(other.handleEventTime);
+  pendingFunctorTime.merge(other.pendingFunctorTime);
+  pendingFunctors.merge(other.pendingFunctors);
+  readBytes.merge(other.readBytes);
+  readSpillBytes.merge(other.readSpillBytes);
+  zeroCopySendBytes.merge(other.zeroCopySendBytes);
+  zeroCopyFallbackBytes.merge(other.zeroCopyFallbackBytes);
+  zeroCopyKernelCopied.merge(other.zeroCopyKernelCopied);
+  corkedSends.merge(other.corkedSends);
+}
+
+std::string EventLoopStats::Snapshot::toString() const {
+  std::string s = "iterations=" + std::to_string(iterations);
+  s += "\n  pollTime(ns)           " + pollTime.toString();
+  s += "\n  activeChannels         " + activeChannels.toString();
+  s += "\n  handleEventTime(ns)    " + handleEventTime.toString();
+  s += "\n  pendingFunctorTime(ns) " + pendingFunctorTime.toString();
+  s += "\n  pendingFunctors        " + pendingFunctors.toString();
+  s += "\n  readBytes              " + readBytes.toString();
+  s += "\n  readSpillBytes         " + readSpillBytes.toString();
+  s += "\n  zeroCopySendBytes      " + zeroCopySendBytes.toString();
+  s += "\n  zeroCopyFallbackBytes  " + zeroCopyFallbackBytes.toString();
+  s += "\n  zeroCopyKernelCopied   " + zeroCopyKernelCopied.toString();
+  s += "\n  corkedSends            " + corkedSends.toString();
+  return s;
+}
+
+EventLoopStats::Snapshot EventLoopStats::snapshot() const {
+  Snapshot snap;
+  snap.pollTime = pollTime.snapshot();
+  snap.activeChannels = activeChannels.snapshot();
+  snap.handleEventTime = handleEventTime.snapshot();
+  snap.pendingFunctorTime = pendingFunctorTime.snapshot();
+  snap.pendingFunctors = pendingFunctors.snapshot();
+  snap.readBytes = readBytes.snapshot();
+  snap.readSpillBytes = readSpillBytes.snapshot();
+  snap.zeroCopySendBytes = zeroCopySendBytes.snapshot();
+  snap.zeroCopyFallbackBytes = zeroCopyFallbackBytes.snapshot();
+  snap.zeroCopyKernelCopied = zeroCopyKernelCopied.snapshot();
+  snap.corkedSends = corkedSends.snapshot();
+  // 每轮最后记录pendingFunctors，用它的计数作为轮数
+  snap.iterations = snap.pendingFunctors.count;
+  return snap;
+}
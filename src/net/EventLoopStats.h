@@ -0,0 +1,119 @@
+#ifndef MYMUDUO_NET_EVENTLOOPSTATS_H
+#define MYMUDUO_NET_EVENTLOOPSTATS_H
+
+#include "src/base/noncopyable.h"
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include <time.h>
+
+namespace mymuduo {
+
+/**
+ * 以2的幂为桶边界的直方图：第0个桶记录0，第i个桶记录[2^(i-1), 2^i)。
+ * 只允许一个线程record(loop线程)，任意线程都可以snapshot，
+ * 计数都是relaxed的原子变量，写入时不需要带lock前缀的指令。
+ */
+class Histogram : noncopyable {
+public:
+  static const int kNumBuckets = 64;
+
+  struct Snapshot {
+    Snapshot();
+    void merge(const Snapshot &other);
+    double mean() const;
+    // 第p(0~1)分位数所在桶的上界
+    uint64_t percentile(double p) const;
+    // count/mean/p50/p99/max
+    std::string toString() const;
+
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[kNumBuckets];
+  };
+
+  Histogram();
+
+  void record(uint64_t value) {
+    const int i = value == 0 ? 0 : 64 - __builtin_clzll(value);
+    increment(&buckets_[i < kNumBuckets ? i : kNumBuckets - 1], 1);
+    increment(&count_, 1);
+    increment(&sum_, value);
+    if (value > max_.load(std::memory_order_relaxed)) {
+      max_.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  Snapshot snapshot() const;
+  // 累计值，可以在任意线程调用
+  uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+
+private:
+  static void increment(std::atomic<uint64_t> *counter, uint64_t n) {
+    counter->store(counter->load(std::memory_order_relaxed) + n,
+                   std::memory_order_relaxed);
+  }
+
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> sum_;
+  std::atomic<uint64_t> max_;
+  std::atomic<uint64_t> buckets_[kNumBuckets];
+};
+
+/**
+ * EventLoop每一轮循环的统计，耗时的单位都是纳秒
+ * 由loop线程在EventLoop::loop()中记录，可以在任意线程取快照
+ */
+class EventLoopStats : noncopyable {
+public:
+  struct Snapshot {
+    Snapshot() : iterations(0) {}
+    void merge(const Snapshot &other);
+    std::string toString() const;
+
+    uint64_t iterations;
+    Histogram::Snapshot pollTime;           // 阻塞在poller_->poll中的时间
+    Histogram::Snapshot activeChannels;     // 每轮的活跃channel数
+    Histogram::Snapshot handleEventTime;    // 每轮Channel::handleEvent的总时间
+    Histogram::Snapshot pendingFunctorTime; // 每轮doPendingFunctors的时间
+    Histogram::Snapshot pendingFunctors;    // 每轮取出的回调数
+    Histogram::Snapshot readBytes;      // 连接每次读socket读到的字节数
+    Histogram::Snapshot readSpillBytes; // 读溢出到extrabuf、需要再拷贝一次的字节数
+    // 开启MSG_ZEROCOPY的连接：
+    Histogram::Snapshot zeroCopySendBytes;     // 每次以MSG_ZEROCOPY发送的字节数
+    Histogram::Snapshot zeroCopyFallbackBytes; // 每次仍然拷贝发送的字节数
+    Histogram::Snapshot zeroCopyKernelCopied;  // 每个完成通知中内核改为拷贝的发送次数
+    Histogram::Snapshot corkedSends; // 自动合并发送的连接每次flush合并的send次数
+  };
+
+  // 单调时钟，走vDSO，开销在几十纳秒
+  static int64_t nowNs() {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+
+  Snapshot snapshot() const;
+  // 累计处理事件和回调的时间，不需要完整的快照，可以在任意线程调用
+  uint64_t busyNs() const {
+    return handleEventTime.sum() + pendingFunctorTime.sum();
+  }
+
+  Histogram pollTime;
+  Histogram activeChannels;
+  Histogram handleEventTime;
+  Histogram pendingFunctorTime;
+  Histogram pendingFunctors;
+  Histogram readBytes;
+  Histogram readSpillBytes;
+  Histogram zeroCopySendBytes;
+  Histogram zeroCopyFallbackBytes;
+  Histogram zeroCopyKernelCopied;
+  Histogram corkedSends;
+};
+
+} // namespace mymuduo
+
+#endif // MYMUDUO_NET_EVENTLOOPSTATS_H
@@ -1,12 +1,14 @@
 #include "src/net/EventLoopThreadPool.h"
+#include "src/base/CpuAffinity.h"
 #include "src/net/EventLoopThread.h"
+#include "src/net/EventLoop.h"
 
 using namespace mymuduo;
 
 EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop,
                                          const std::string &nameArg)
     : baseLoop_(baseLoop), name_(nameArg), started_(false), numThreads_(0),
-      next_(0) {}
+      next_(0), busyPollUs_(0), numaNode_(-1), timingWheel_(false) {}
 
 EventLoopThreadPool::~EventLoopThreadPool() {
   // Don't delete loop, it's stack variable
@@ -18,8 +20,10 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb) {
   // 循环创建线程
   for (int i = 0; i < numThreads_; i++) {
     std::string name = name_ + std::to_string(i);
+    ThreadInitCallback init = std::bind(&EventLoopThreadPool::initLoop, this,
+                                        cb, i, std::placeholders::_1);
     // 创建EventLoopThread对象
-    EventLoopThread *t = new EventLoopThread(cb, name);
+    EventLoopThread *t = new EventLoopThread(init, name);
     // 加入此EventLoopThread入容器
     threads_.emplace_back(std::unique_ptr<EventLoopThread>(t));
     // 底层创建线程 绑定一个新的EventLoop 并返回该loop的地址
@@ -28,9 +32,36 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb) {
   }
 
   // 整个服务端只有一个线程运行baseLoop
-  if (numThreads_ == 0 && cb) {
+  if (numThreads_ == 0) {
     // 那么不用交给新线程去运行用户回调函数了
-    cb(baseLoop_);
+    initLoop(cb, 0, baseLoop_);
+  }
+}
+
+void EventLoopThreadPool::initLoop(const ThreadInitCallback &cb, int index,
+                                   EventLoop *loop) {
+  // 先确定线程的位置，此后loop线程分配的缓冲区等内存都在本节点上
+  std::vector<int> cpus;
+  if (!cpuSets_.empty()) {
+    cpus = cpuSets_[index % cpuSets_.size()];
+  } else if (numaNode_ >= 0) {
+    cpus = CpuAffinity::cpusOfNumaNode(numaNode_);
+  }
+  if (!cpus.empty()) {
+    CpuAffinity::bindCurrentThread(cpus);
+  }
+  if (numaNode_ >= 0) {
+    CpuAffinity::preferNumaNode(numaNode_);
+  }
+
+  if (busyPollUs_ > 0) {
+    loop->setBusyPoll(busyPollUs_);
+  }
+  if (timingWheel_) {
+    loop->setTimingWheel(true);
+  }
+  if (cb) {
+    cb(loop);
   }
 }
 
@@ -54,10 +85,33 @@ EventLoop *EventLoopThreadPool::getNextLoop() {
   return loop;
 }
 
+EventLoop *EventLoopThreadPool::getLoopForConnection(const InetAddress &peerAddr) {
+  if (loops_.empty() || !selector_) {
+    return getNextLoop();
+  }
+  return selector_->select(loops_, peerAddr);
+}
+
 std::vector<EventLoop *> EventLoopThreadPool::getAllLoops() {
   if (loops_.empty()) {
     return std::vector<EventLoop *>{baseLoop_};
   } else {
     return loops_;
   }
-}
\ No newline at end of file
+}
+
+EventLoopStats::Snapshot EventLoopThreadPool::stats() {
+  EventLoopStats::Snapshot total;
+  for (EventLoop *loop : getAllLoops()) {
+    total.merge(loop->stats());
+  }
+  return total;
+}
+
+BufferPool::Stats EventLoopThreadPool::bufferPoolStats() {
+  BufferPool::Stats total;
+  for (EventLoop *loop : getAllLoops()) {
+    total.merge(loop->bufferPool()->stats());
+  }
+  return total;
+}
@@ -2,6 +2,9 @@
 #define MYMUDUO_NET_EVENTLOOPTHREADPOOL_H
 
 #include "src/base/noncopyable.h"
+#include "src/net/BufferPool.h"
+#include "src/net/EventLoopStats.h"
+#include "src/net/LoopSelector.h"
 #include <functional>
 #include <memory>
 #include <string>
@@ -10,6 +13,7 @@
 namespace mymuduo {
 class EventLoop;
 class EventLoopThread;
+class InetAddress;
 class EventLoopThreadPool : noncopyable {
 public:
   using ThreadInitCallback = std::function<void(EventLoop *)>;
@@ -20,17 +24,47 @@ public:
   // 设置线程数量
   void setThreadNum(int numThreads) { numThreads_ = numThreads; }
 
+  // 为每个subLoop开启自适应busy poll，见EventLoop::setBusyPoll
+  void setBusyPoll(int maxSpinUs) { busyPollUs_ = maxSpinUs; }
+
+  // subLoop的定时器使用时间轮，见EventLoop::setTimingWheel
+  void setTimingWheel(bool on) { timingWheel_ = on; }
+
+  // 第i个subLoop的线程绑定到cpuSets[i % cpuSets.size()]中的CPU上
+  void setCpuAffinity(std::vector<std::vector<int>> cpuSets) {
+    cpuSets_ = std::move(cpuSets);
+  }
+  // subLoop放在NUMA节点node上：线程之后分配的内存优先使用该节点，
+  // 没有设置setCpuAffinity时线程绑定到该节点的所有CPU上
+  void setNumaNode(int node) { numaNode_ = node; }
+
+  // 为新连接选择subLoop的策略，默认轮询，见LoopSelector
+  void setLoopSelector(std::unique_ptr<LoopSelector> selector) {
+    selector_ = std::move(selector);
+  }
+
   // 启动线程池
   void start(const ThreadInitCallback &cb = ThreadInitCallback());
 
   // 如果工作在多线程中，baseLoop_(mainLoop)会默认以轮询的方式分配Channel给subLoop
   EventLoop *getNextLoop();
+  // 按setLoopSelector设置的策略为来自peerAddr的新连接选择loop，只在baseLoop线程调用
+  EventLoop *getLoopForConnection(const InetAddress &peerAddr);
 
   std::vector<EventLoop *> getAllLoops();
 
+  // getAllLoops()中所有loop的统计之和，可以在任意线程调用
+  EventLoopStats::Snapshot stats();
+  // getAllLoops()中所有loop的BufferPool统计之和，可以在任意线程调用
+  BufferPool::Stats bufferPoolStats();
+
   bool started() const { return started_; }
   const std::string& name() const { return name_; }
 
+private:
+  // 在loop线程中应用线程池统一的loop配置，再调用用户的回调
+  void initLoop(const ThreadInitCallback &cb, int index, EventLoop *loop);
+
 private:
   EventLoop *baseLoop_; // 用户使用muduo创建的loop 如果线程数为1
                         // 那直接使用用户创建的loop 否则创建多EventLoop
@@ -38,6 +72,11 @@ private:
   bool started_;   // 开启线程池标志
   int numThreads_; // 创建线程数量
   int next_;       // 轮询的下标
+  int busyPollUs_; // subLoop的busy poll自旋上限，0表示关闭
+  int numaNode_;   // subLoop所在的NUMA节点，-1表示不限制
+  bool timingWheel_; // subLoop的定时器是否使用时间轮
+  std::vector<std::vector<int>> cpuSets_; // 每个subLoop可以运行的CPU
+  std::unique_ptr<LoopSelector> selector_; // 为空时轮询
   std::vector<std::unique_ptr<EventLoopThread>> threads_;
   std::vector<EventLoop *> loops_;
 };
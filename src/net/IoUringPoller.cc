@@ -0,0 +1,310 @@
+#include "src/net/IoUringPoller.h"
+#include "src/net/Channel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <errno.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace mymuduo;
+
+namespace {
+const int kNew = -1;  // 某个channel还没添加至Poller
+const int kAdded = 1; // 某个channel已经添加至Poller
+
+int sysIoUringSetup(unsigned entries, io_uring_params *params) {
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int sysIoUringEnter(int fd, unsigned toSubmit, unsigned minComplete,
+                    unsigned flags, const void *arg, size_t argSize) {
+  return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit,
+                                    minComplete, flags, arg, argSize));
+}
+} // namespace
+
+bool IoUringPoller::isSupported() {
+  static const bool supported = [] {
+    io_uring_params params;
+    memset(&params, 0, sizeof params);
+    int fd = sysIoUringSetup(1, &params);
+    if (fd < 0) {
+      return false;
+    }
+    ::close(fd);
+    return (params.features & IORING_FEAT_EXT_ARG) != 0;
+  }();
+  return supported;
+}
+
+IoUringPoller::IoUringPoller(EventLoop *loop)
+    : Poller(loop), ringFd_(-1), sqRing_(nullptr), sqRingSize_(0),
+      sqHead_(nullptr), sqTail_(nullptr), sqMask_(nullptr), sqFlags_(nullptr),
+      sqArray_(nullptr), sqes_(nullptr), sqesSize_(0), sqeTail_(0),
+      cqRing_(nullptr), cqRingSize_(0), cqHead_(nullptr), cqTail_(nullptr),
+      cqMask_(nullptr), cqes_(nullptr), nextSeq_(0) {
+  setupRing();
+}
+
+IoUringPoller::~IoUringPoller() {
+  ::munmap(sqes_, sqesSize_);
+  if (cqRing_ != sqRing_) {
+    ::munmap(cqRing_, cqRingSize_);
+  }
+  ::munmap(sqRing_, sqRingSize_);
+  ::close(ringFd_);
+}
+
+void IoUringPoller::setupRing() {
+  memset(&params_, 0, sizeof params_);
+  params_.flags = IORING_SETUP_CQSIZE;
+  params_.cq_entries = kRingEntries * kCqFactor;
+  ringFd_ = sysIoUringSetup(kRingEntries, &params_);
+  if (ringFd_ < 0) {
+    LOG_SYSFATAL << "IoUringPoller::setupRing io_uring_setup";
+  }
+
+  sqRingSize_ = params_.sq_off.array + params_.sq_entries * sizeof(unsigned);
+  cqRingSize_ =
+      params_.cq_off.cqes + params_.cq_entries * sizeof(io_uring_cqe);
+  const bool singleMmap = params_.features & IORING_FEAT_SINGLE_MMAP;
+  if (singleMmap) {
+    sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+  }
+
+  sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+  if (sqRing_ == MAP_FAILED) {
+    LOG_SYSFATAL << "IoUringPoller::setupRing mmap sq ring";
+  }
+  if (singleMmap) {
+    cqRing_ = sqRing_;
+  } else {
+    cqRing_ = ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+    if (cqRing_ == MAP_FAILED) {
+      LOG_SYSFATAL << "IoUringPoller::setupRing mmap cq ring";
+    }
+  }
+  sqesSize_ = params_.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = static_cast<io_uring_sqe *>(
+      ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES));
+  if (sqes_ == MAP_FAILED) {
+    LOG_SYSFATAL << "IoUringPoller::setupRing mmap sqes";
+  }
+
+  char *sq = static_cast<char *>(sqRing_);
+  sqHead_ = reinterpret_cast<unsigned *>(sq + params_.sq_off.head);
+  sqTail_ = reinterpret_cast<unsigned *>(sq + params_.sq_off.tail);
+  sqMask_ = reinterpret_cast<unsigned *>(sq + params_.sq_off.ring_mask);
+  sqFlags_ = reinterpret_cast<unsigned *>(sq + params_.sq_off.flags);
+  sqArray_ = reinterpret_cast<unsigned *>(sq + params_.sq_off.array);
+  sqeTail_ = *sqTail_;
+
+  char *cq = static_cast<char *>(cqRing_);
+  cqHead_ = reinterpret_cast<unsigned *>(cq + params_.cq_off.head);
+  cqTail_ = reinterpret_cast<unsigned *>(cq + params_.cq_off.tail);
+  cqMask_ = reinterpret_cast<unsigned *>(cq + params_.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params_.cq_off.cqes);
+}
+
+Timestamp IoUringPoller::poll(int timeoutMs, ChannelList *activeChannels) {
+  LOG_TRACE << "fd total count " << numChannels();
+  // 上一轮返回的channel以及修改过事件的channel，在这里统一重新提交
+  // 期间被移除的fd对应的项已清零，dirty为false
+  for (int fd : pendingArms_) {
+    PollRequest &req = requests_[fd];
+    if (req.dirty) {
+      req.dirty = false;
+      arm(fd, req);
+    }
+  }
+  pendingArms_.clear();
+
+  // CQ中已有完成事件时直接收割，只有还有待提交的请求才进入内核
+  int numEvents = reapCompletions(activeChannels);
+  int ret = 0;
+  const unsigned toSubmit = pendingSubmissions();
+  if (numEvents == 0 && timeoutMs != 0) {
+    ret = enter(toSubmit, 1, timeoutMs);
+  } else if (toSubmit > 0) {
+    ret = enter(toSubmit, 0, 0);
+  }
+  int savedErrno = errno;
+  Timestamp now(Timestamp::now());
+  numEvents += reapCompletions(activeChannels);
+
+  if (numEvents > 0) {
+    LOG_TRACE << numEvents << " events happened";
+  } else if (ret >= 0 || savedErrno == ETIME) {
+    LOG_TRACE << "nothing happened";
+  } else if (savedErrno != EINTR && savedErrno != EBUSY) {
+    // error happens, log uncommon ones
+    errno = savedErrno;
+    LOG_SYSERR << "IoUringPoller::poll()";
+  }
+  return now;
+}
+
+void IoUringPoller::updateChannel(Channel *channel) {
+  assertInLoopThread();
+  const int index = channel->index();
+  int fd = channel->fd();
+  if (index == kNew) {
+    addChannel(channel);
+    if (static_cast<size_t>(fd) >= requests_.size()) {
+      requests_.resize(channels_.size(), PollRequest());
+    }
+    assert(!requests_[fd].armed && !requests_[fd].dirty);
+    channel->set_index(kAdded);
+  } else {
+    assert(findChannel(fd) == channel);
+    assert(index == kAdded);
+  }
+  // 事件的修改推迟到下一次poll()，和等待合并为一次系统调用
+  markDirty(fd, requests_[fd]);
+}
+
+void IoUringPoller::removeChannel(Channel *channel) {
+  assertInLoopThread();
+  int fd = channel->fd();
+  assert(findChannel(fd) == channel);
+  assert(channel->isNoneEvent());
+  assert(channel->index() == kAdded);
+
+  PollRequest &req = requests_[fd];
+  if (req.armed) {
+    prepPollRemove(encode(fd, req.seq));
+  }
+  // 清零后过期的完成事件会因armed为false被丢弃
+  req = PollRequest();
+  eraseChannel(channel);
+  channel->set_index(kNew);
+}
+
+void IoUringPoller::markDirty(int fd, PollRequest &req) {
+  if (!req.dirty) {
+    req.dirty = true;
+    pendingArms_.push_back(fd);
+  }
+}
+
+void IoUringPoller::arm(int fd, PollRequest &req) {
+  Channel *channel = channels_[fd];
+  assert(channel != nullptr);
+  const uint32_t events = static_cast<uint32_t>(channel->events());
+  if (req.armed) {
+    if (req.events == events) {
+      return;
+    }
+    // 感兴趣的事件变了，撤销旧请求，旧请求的完成事件会因序号不匹配被丢弃
+    prepPollRemove(encode(fd, req.seq));
+    req.armed = false;
+  }
+  if (events != 0) {
+    req.seq = ++nextSeq_;
+    req.events = events;
+    req.armed = true;
+    prepPollAdd(fd, events, encode(fd, req.seq));
+  }
+}
+
+io_uring_sqe *IoUringPoller::getSqe() {
+  const unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+  if (sqeTail_ - head >= params_.sq_entries) {
+    // SQ已满，先提交一批
+    enter(pendingSubmissions(), 0, 0);
+  }
+  io_uring_sqe *sqe = &sqes_[sqeTail_ & *sqMask_];
+  memset(sqe, 0, sizeof *sqe);
+  return sqe;
+}
+
+void IoUringPoller::prepPollAdd(int fd, uint32_t events, uint64_t userData) {
+  io_uring_sqe *sqe = getSqe();
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll32_events = events;
+  sqe->user_data = userData;
+  sqArray_[sqeTail_ & *sqMask_] = sqeTail_ & *sqMask_;
+  ++sqeTail_;
+  __atomic_store_n(sqTail_, sqeTail_, __ATOMIC_RELEASE);
+}
+
+void IoUringPoller::prepPollRemove(uint64_t userData) {
+  io_uring_sqe *sqe = getSqe();
+  sqe->opcode = IORING_OP_POLL_REMOVE;
+  sqe->fd = -1;
+  sqe->addr = userData;
+  sqe->user_data = kRemoveUserData;
+  sqArray_[sqeTail_ & *sqMask_] = sqeTail_ & *sqMask_;
+  ++sqeTail_;
+  __atomic_store_n(sqTail_, sqeTail_, __ATOMIC_RELEASE);
+}
+
+unsigned IoUringPoller::pendingSubmissions() const {
+  return sqeTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+}
+
+int IoUringPoller::enter(unsigned toSubmit, unsigned minComplete,
+                         int timeoutMs) {
+  unsigned flags = 0;
+  io_uring_getevents_arg arg;
+  __kernel_timespec ts;
+  memset(&arg, 0, sizeof arg);
+  if (minComplete > 0) {
+    flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    if (timeoutMs >= 0) {
+      ts.tv_sec = timeoutMs / 1000;
+      ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000 * 1000;
+      arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+  } else if (__atomic_load_n(sqFlags_, __ATOMIC_ACQUIRE) &
+             IORING_SQ_CQ_OVERFLOW) {
+    // CQ溢出的事件暂存在内核中，需要GETEVENTS把它们刷回CQ
+    flags |= IORING_ENTER_GETEVENTS;
+  }
+  int ret = sysIoUringEnter(ringFd_, toSubmit, minComplete, flags,
+                            (flags & IORING_ENTER_EXT_ARG) ? &arg : nullptr,
+                            (flags & IORING_ENTER_EXT_ARG) ? sizeof arg : 0);
+  if (ret < 0 && errno != EINTR && errno != ETIME && errno != EBUSY) {
+    LOG_SYSERR << "IoUringPoller::enter io_uring_enter";
+  }
+  return ret;
+}
+
+int IoUringPoller::reapCompletions(ChannelList *activeChannels) {
+  unsigned head = *cqHead_;
+  const unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+  int numEvents = 0;
+  for (; head != tail; ++head) {
+    const io_uring_cqe &cqe = cqes_[head & *cqMask_];
+    if (cqe.user_data == kRemoveUserData) {
+      continue;
+    }
+    int fd = static_cast<int>(cqe.user_data >> 32);
+    uint32_t seq = static_cast<uint32_t>(cqe.user_data);
+    PollRequest &req = requests_[fd];
+    if (!req.armed || req.seq != seq) {
+      // 已被撤销或fd已被复用的过期事件
+      continue;
+    }
+    // one-shot请求已经完成，等channel处理完事件后在下一次poll()中重新提交，
+    // 效果上与水平触发一致
+    req.armed = false;
+    markDirty(fd, req);
+    if (cqe.res == -ECANCELED) {
+      continue;
+    }
+    Channel *channel = channels_[fd];
+    channel->set_revents(cqe.res < 0 ? POLLERR : cqe.res);
+    activeChannels->push_back(channel);
+    ++numEvents;
+  }
+  __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+  return numEvents;
+}
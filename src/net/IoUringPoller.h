@@ -0,0 +1,89 @@
+#ifndef MYMUDUO_NET_IOURINGPOLLER_H
+#define MYMUDUO_NET_IOURINGPOLLER_H
+#include "src/net/Poller.h"
+#include <linux/io_uring.h>
+#include <vector>
+
+namespace mymuduo {
+/// 基于io_uring的Poller实现
+/// 每个channel对应一个one-shot的IORING_OP_POLL_ADD请求，完成后在下一次poll()时重新提交，
+/// 所有的注册/修改/删除请求都先写入SQ，在poll()中与等待操作合并为一次io_uring_enter。
+/// 若CQ中已有完成事件，则直接从共享内存中收割，不进入内核。
+class IoUringPoller : public Poller {
+public:
+  IoUringPoller(EventLoop *loop);
+  ~IoUringPoller();
+
+  Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
+  void updateChannel(Channel *channel) override;
+  void removeChannel(Channel *channel) override;
+
+  // 内核是否支持本实现所需的io_uring特性(IORING_FEAT_EXT_ARG, 5.11+)
+  static bool isSupported();
+
+private:
+  // 每个fd上提交的poll请求状态
+  struct PollRequest {
+    uint32_t seq;      // 当前请求的序号，用于过滤过期的完成事件
+    uint32_t events;   // 已提交给内核的事件掩码
+    bool armed;        // 内核中是否有未完成的poll请求
+    bool dirty;        // 是否已在pendingArms_中等待重新提交
+  };
+
+  void setupRing();
+  io_uring_sqe *getSqe();
+  // 把SQ中尚未提交的请求交给内核，可选地等待至少一个完成事件
+  int enter(unsigned toSubmit, unsigned minComplete, int timeoutMs);
+  void markDirty(int fd, PollRequest &req);
+  // 根据channel当前感兴趣的事件重新提交poll请求
+  void arm(int fd, PollRequest &req);
+  void prepPollAdd(int fd, uint32_t events, uint64_t userData);
+  void prepPollRemove(uint64_t userData);
+  // 收割CQ中的完成事件，填写活跃的连接
+  int reapCompletions(ChannelList *activeChannels);
+  // 已写入SQ但内核尚未取走的请求数
+  unsigned pendingSubmissions() const;
+
+  static uint64_t encode(int fd, uint32_t seq) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(fd)) << 32) | seq;
+  }
+
+private:
+  // 与channels_一样以fd为下标，未注册的fd对应的项全为0
+  using RequestMap = std::vector<PollRequest>;
+  // 默认SQ大小，CQ为其kCqFactor倍
+  static const unsigned kRingEntries = 256;
+  static const unsigned kCqFactor = 16;
+  // POLL_REMOVE请求自身完成事件的user_data
+  static const uint64_t kRemoveUserData = ~0ULL;
+
+  int ringFd_;
+  io_uring_params params_;
+
+  // SQ ring
+  void *sqRing_;
+  size_t sqRingSize_;
+  unsigned *sqHead_;
+  unsigned *sqTail_;
+  unsigned *sqMask_;
+  unsigned *sqFlags_;
+  unsigned *sqArray_;
+  io_uring_sqe *sqes_;
+  size_t sqesSize_;
+  unsigned sqeTail_; // 本地已填写的位置
+
+  // CQ ring
+  void *cqRing_;
+  size_t cqRingSize_;
+  unsigned *cqHead_;
+  unsigned *cqTail_;
+  unsigned *cqMask_;
+  io_uring_cqe *cqes_;
+
+  uint32_t nextSeq_;
+  RequestMap requests_;
+  std::vector<int> pendingArms_; // 等待(重新)提交poll请求的fd
+};
+} // namespace mymuduo
+
+#endif // MYMUDUO_NET_IOURINGPOLLER_H
@@ -0,0 +1,166 @@
+#include "src/net/LoopSelector.h"
+#include "src/net/EventLoop.h"
+#include "src/net/EventLoopStats.h"
+#include "src/net/InetAddress.h"
+
+#include <algorithm>
+
+using namespace mymuduo;
+
+namespace {
+
+class RoundRobinSelector : public LoopSelector {
+public:
+  RoundRobinSelector() : next_(0) {}
+
+  EventLoop *select(const std::vector<EventLoop *> &loops,
+                    const InetAddress &) override {
+    if (next_ >= loops.size()) {
+      next_ = 0;
+    }
+    return loops[next_++];
+  }
+
+private:
+  size_t next_;
+};
+
+class LeastConnectionsSelector : public LoopSelector {
+public:
+  // 连接数相同时从上次选中的下一个开始找，空闲时退化为轮询
+  LeastConnectionsSelector() : next_(0) {}
+
+  EventLoop *select(const std::vector<EventLoop *> &loops,
+                    const InetAddress &) override {
+    const size_t n = loops.size();
+    size_t best = next_ % n;
+    for (size_t i = 1; i < n; ++i) {
+      size_t index = (next_ + i) % n;
+      if (loops[index]->numConnections() < loops[best]->numConnections()) {
+        best = index;
+      }
+    }
+    next_ = best + 1;
+    return loops[best];
+  }
+
+private:
+  size_t next_;
+};
+
+class LeastBusySelector : public LoopSelector {
+public:
+  explicit LeastBusySelector(int sampleIntervalMs)
+      : intervalNs_(static_cast<int64_t>(sampleIntervalMs) * 1000 * 1000),
+        lastSampleNs_(0) {}
+
+  EventLoop *select(const std::vector<EventLoop *> &loops,
+                    const InetAddress &) override {
+    const int64_t now = EventLoopStats::nowNs();
+    if (lastBusyNs_.size() != loops.size()) {
+      lastBusyNs_.resize(loops.size());
+      score_.assign(loops.size(), 0);
+      costPerConn_.assign(loops.size(), 1);
+      for (size_t i = 0; i < loops.size(); ++i) {
+        lastBusyNs_[i] = loops[i]->busyNs();
+      }
+      lastSampleNs_ = now;
+    } else if (now - lastSampleNs_ >= intervalNs_) {
+      sample(loops);
+      lastSampleNs_ = now;
+    }
+
+    size_t best = 0;
+    for (size_t i = 1; i < loops.size(); ++i) {
+      if (score_[i] < score_[best]) {
+        best = i;
+      }
+    }
+    // 两次采样之间分到的连接还没有反映在忙碌时间里，按该loop每个连接的平均开销
+    // 先计入，否则一个采样周期内的新连接会全部涌向同一个loop
+    score_[best] += costPerConn_[best];
+    return loops[best];
+  }
+
+private:
+  void sample(const std::vector<EventLoop *> &loops) {
+    for (size_t i = 0; i < loops.size(); ++i) {
+      uint64_t busy = loops[i]->busyNs();
+      score_[i] = busy - lastBusyNs_[i];
+      lastBusyNs_[i] = busy;
+      int conns = std::max(loops[i]->numConnections(), 1);
+      costPerConn_[i] = std::max<uint64_t>(score_[i] / conns, 1);
+    }
+  }
+
+  const int64_t intervalNs_;
+  int64_t lastSampleNs_;
+  std::vector<uint64_t> lastBusyNs_;  // 上次采样时各个loop的累计忙碌时间
+  std::vector<uint64_t> score_;       // 上个周期的忙碌时间 + 之后分配的连接的估计开销
+  std::vector<uint64_t> costPerConn_; // 上个周期每个连接的平均忙碌时间，至少为1
+};
+
+class PowerOfTwoChoicesSelector : public LoopSelector {
+public:
+  PowerOfTwoChoicesSelector()
+      : state_(static_cast<uint64_t>(EventLoopStats::nowNs()) | 1) {}
+
+  EventLoop *select(const std::vector<EventLoop *> &loops,
+                    const InetAddress &) override {
+    const size_t n = loops.size();
+    if (n == 1) {
+      return loops[0];
+    }
+    size_t a = random() % n;
+    size_t b = random() % (n - 1);
+    if (b >= a) {
+      ++b;
+    }
+    return loops[b]->numConnections() < loops[a]->numConnections() ? loops[b]
+                                                                    : loops[a];
+  }
+
+private:
+  // xorshift64，只在baseLoop线程使用，不需要加锁
+  uint64_t random() {
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 7;
+    state_ ^= state_ << 17;
+    return state_;
+  }
+
+  uint64_t state_;
+};
+
+class PeerHashSelector : public LoopSelector {
+public:
+  EventLoop *select(const std::vector<EventLoop *> &loops,
+                    const InetAddress &peerAddr) override {
+    // 只用IP不用端口，同一个客户端的多个连接落在同一个loop
+    uint64_t ip = peerAddr.getSockAddr()->sin_addr.s_addr;
+    uint64_t hash = (ip * 0x9E3779B97F4A7C15ULL) >> 32;
+    return loops[hash % loops.size()];
+  }
+};
+
+} // namespace
+
+std::unique_ptr<LoopSelector> LoopSelector::newRoundRobin() {
+  return std::unique_ptr<LoopSelector>(new RoundRobinSelector);
+}
+
+std::unique_ptr<LoopSelector> LoopSelector::newLeastConnections() {
+  return std::unique_ptr<LoopSelector>(new LeastConnectionsSelector);
+}
+
+std::unique_ptr<LoopSelector> LoopSelector::newLeastBusy(int sampleIntervalMs) {
+  return std::unique_ptr<LoopSelector>(new LeastBusySelector(sampleIntervalMs));
+}
+
+std::unique_ptr<LoopSelector> LoopSelector::newPowerOfTwoChoices() {
+  return std::unique_ptr<LoopSelector>(new PowerOfTwoChoicesSelector);
+}
+
+std::unique_ptr<LoopSelector> LoopSelector::newPeerHash() {
+  return std::unique_ptr<LoopSelector>(new PeerHashSelector);
+}
@@ -0,0 +1,43 @@
+#ifndef MYMUDUO_NET_LOOPSELECTOR_H
+#define MYMUDUO_NET_LOOPSELECTOR_H
+
+#include "src/base/noncopyable.h"
+
+#include <memory>
+#include <vector>
+
+namespace mymuduo {
+class EventLoop;
+class InetAddress;
+
+/**
+ * 为新连接选择subLoop的策略，EventLoopThreadPool::getLoopForConnection调用
+ * select只在分配连接的baseLoop线程调用，loops是线程池的全部subLoop，不为空
+ *
+ * 轮询只保证每个loop分到的连接数相同，连接的寿命和负载差别很大时(长连接混着短连接)
+ * 会越来越不均衡，这时可以按loop的实际负载选择：
+ *   RoundRobin       : 轮询，默认
+ *   LeastConnections : 当前连接数最少的loop
+ *   LeastBusy        : 最近一个采样周期内处理事件和回调耗时最少的loop
+ *   PowerOfTwoChoices: 随机取两个loop，选连接数少的一个，开销是常数，
+ *                      并且不会让同时到来的连接都涌向同一个loop
+ *   PeerHash         : 按对端IP哈希，同一个客户端的连接总在同一个loop
+ */
+class LoopSelector : noncopyable {
+public:
+  virtual ~LoopSelector() = default;
+
+  virtual EventLoop *select(const std::vector<EventLoop *> &loops,
+                            const InetAddress &peerAddr) = 0;
+
+  static std::unique_ptr<LoopSelector> newRoundRobin();
+  static std::unique_ptr<LoopSelector> newLeastConnections();
+  // 每隔sampleIntervalMs毫秒读一次各个loop的累计忙碌时间，见EventLoop::busyNs
+  static std::unique_ptr<LoopSelector> newLeastBusy(int sampleIntervalMs = 100);
+  static std::unique_ptr<LoopSelector> newPowerOfTwoChoices();
+  static std::unique_ptr<LoopSelector> newPeerHash();
+};
+
+} // namespace mymuduo
+
+#endif // MYMUDUO_NET_LOOPSELECTOR_H
@@ -1,9 +1,12 @@
 #include "src/net/Poller.h"
 #include "src/net/Channel.h"
 
+#include <algorithm>
+#include <assert.h>
+
 using namespace mymuduo;
 
-Poller::Poller(EventLoop *loop) : ownerLoop_(loop) {}
+Poller::Poller(EventLoop *loop) : numChannels_(0), ownerLoop_(loop) {}
 
 Poller::~Poller() = default;
 
@@ -11,8 +14,25 @@ Poller::~Poller() = default;
 bool Poller::hasChannel(Channel* channel) const
 {
   assertInLoopThread();
-  ChannelMap::const_iterator it = channels_.find(channel->fd());
-  return it != channels_.end() && it->second == channel;
+  return findChannel(channel->fd()) == channel;
+}
+
+void Poller::addChannel(Channel *channel) {
+  const size_t fd = static_cast<size_t>(channel->fd());
+  if (fd >= channels_.size()) {
+    // 按倍数增长，避免fd逐个递增时反复扩容
+    channels_.resize(std::max(fd + 1, channels_.size() * 2), nullptr);
+  }
+  assert(channels_[fd] == nullptr);
+  channels_[fd] = channel;
+  ++numChannels_;
+}
+
+void Poller::eraseChannel(Channel *channel) {
+  const size_t fd = static_cast<size_t>(channel->fd());
+  assert(fd < channels_.size() && channels_[fd] == channel);
+  channels_[fd] = nullptr;
+  --numChannels_;
 }
 
 void Poller::assertInLoopThread() const {
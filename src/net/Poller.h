@@ -4,7 +4,6 @@
 #include "src/base/Timestamp.h"
 #include "src/net/EventLoop.h"
 
-#include <unordered_map>
 #include <vector>
 
 namespace mymuduo {
@@ -34,13 +33,28 @@ public:
 
   virtual bool hasChannel(Channel *channel) const;
 
+  // 是否支持Channel::setEdgeTriggered
+  virtual bool supportsEdgeTriggered() const { return false; }
+
   static Poller *newDefaultPoller(EventLoop *loop);
   void assertInLoopThread() const;
 
 protected:
-  using ChannelMap = std::unordered_map<int, Channel *>;
+  // 以fd为下标的channel表，内核总是分配最小的可用fd，所以表的大小与最大的fd相当。
+  // 就绪事件本身就带着Channel*，只有注册/注销时写表，查表只出现在assert中
+  using ChannelMap = std::vector<Channel *>;
+
+  Channel *findChannel(int fd) const {
+    return static_cast<size_t>(fd) < channels_.size() ? channels_[fd] : nullptr;
+  }
+  void addChannel(Channel *channel);
+  void eraseChannel(Channel *channel);
+  size_t numChannels() const { return numChannels_; }
+
   ChannelMap channels_;
+
 private:
+  size_t numChannels_; // channels_中非空的项数
   EventLoop *ownerLoop_;
 };
 
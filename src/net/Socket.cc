@@ -2,7 +2,9 @@
 #include "src/logger/Logging.h"
 #include "src/net/InetAddress.h"
 
+#include <atomic>
 #include <cstring>
+#include <errno.h>
 #include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <sys/types.h>
@@ -62,8 +64,11 @@ int Socket::accept(InetAddress *peeraddr) {
       ::accept4(sockfd_, (sockaddr *)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
   if (connfd >= 0) {
     peeraddr->setSockAddr(addr);
-  } else {
+  } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+    // 调用者根据errno处理，日志不能改掉它
+    int savedErrno = errno;
     LOG_SYSERR << "Socket::accept()";
+    errno = savedErrno;
   }
   return connfd;
 }
@@ -108,6 +113,38 @@ void Socket::setReusePort(bool on) {
   }
 }
 
+// 超过net.core.busy_poll的值需要CAP_NET_ADMIN。没有权限时每个连接都会失败，
+// 只在第一次报告，之后的socket不再设置
+void Socket::setBusyPoll(int usec) {
+  static std::atomic<bool> denied(false);
+  if (denied.load(std::memory_order_relaxed)) {
+    return;
+  }
+  int ret = setsockopt(sockfd_, SOL_SOCKET, SO_BUSY_POLL, &usec,
+                       static_cast<socklen_t>(sizeof(usec)));
+  if (ret < 0) {
+    if (errno == EPERM) {
+      if (!denied.exchange(true)) {
+        LOG_WARN << "Socket::setBusyPoll() - SO_BUSY_POLL=" << usec
+                 << " needs CAP_NET_ADMIN, disabled for all sockets";
+      }
+    } else {
+      LOG_SYSERR << "Socket::setBusyPoll()";
+    }
+  }
+}
+
+bool Socket::setZeroCopy(bool on) {
+  int optval = on ? 1 : 0;
+  int ret = setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &optval,
+                       static_cast<socklen_t>(sizeof(optval)));
+  if (ret < 0) {
+    LOG_SYSERR << "Socket::setZeroCopy()";
+    return false;
+  }
+  return true;
+}
+
 void Socket::setKeepAlive(bool on) {
   int optval = on ? 1 : 0;
   int ret = setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &optval,
@@ -29,6 +29,8 @@ public:
   void setReuseAddr(bool on);  // 设置地址复用
   void setReusePort(bool on);  // 设置端口复用
   void setKeepAlive(bool on);  // 设置长连接
+  void setBusyPoll(int usec);  // 设置SO_BUSY_POLL，阻塞读时在驱动队列上自旋usec微秒
+  bool setZeroCopy(bool on);   // 设置SO_ZEROCOPY，内核不支持时返回false
 
   static int createNonblockingFd();
   static int getSocketError(int sockfd);
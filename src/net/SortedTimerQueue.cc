@@ -0,0 +1,147 @@
+#include "src/net/SortedTimerQueue.h"
+#include "src/logger/Logging.h"
+#include "src/net/EventLoop.h"
+
+using namespace mymuduo;
+
+SortedTimerQueue::SortedTimerQueue(EventLoop *loop)
+    : TimerQueue(loop, kSorted), timers_(), numCanceled_(0) {}
+
+SortedTimerQueue::~SortedTimerQueue() = default;
+
+TimerId SortedTimerQueue::addTimer(TimerCallback cb, Timestamp when,
+                                   double interval) {
+  TimerId timerId;
+  uint32_t index = pool_.allocate(&timerId);
+  Node &node = pool_.at(index);
+  node.timer.reset(std::move(cb), when, interval);
+  node.state = kPending;
+  node.canceled = false;
+  if (loop_->isInLoopThread()) {
+    addTimerInLoop(index);
+  } else {
+    loop_->queueInLoop([this, index] { addTimerInLoop(index); });
+  }
+  return timerId;
+}
+
+void SortedTimerQueue::cancel(TimerId timerId) {
+  if (loop_->isInLoopThread()) {
+    cancelInLoop(timerId);
+  } else {
+    loop_->queueInLoop([this, timerId] { cancelInLoop(timerId); });
+  }
+}
+
+void SortedTimerQueue::addTimerInLoop(uint32_t index) {
+  Node &node = pool_.at(index);
+  if (node.canceled) {
+    release(index);
+    return;
+  }
+  node.state = kQueued;
+  bool earliestChanged = insert(index);
+  if (earliestChanged) {
+    resetTimerfd(node.timer.expiration());
+  }
+}
+
+void SortedTimerQueue::cancelInLoop(TimerId timerId) {
+  uint32_t index = pool_.find(timerId);
+  if (index == TimerPool<Node>::kNil) {
+    // 已经触发或取消过
+    return;
+  }
+  Node &node = pool_.at(index);
+  if (node.canceled) {
+    return;
+  }
+  node.canceled = true;
+  if (node.state == kQueued) {
+    // 不在set中查找，留给handleExpired或compact移除
+    ++numCanceled_;
+    if (numCanceled_ >= kMinCompaction && numCanceled_ * 2 > timers_.size()) {
+      compact();
+    }
+  }
+}
+
+void SortedTimerQueue::handleExpired(Timestamp now) {
+  // move out all expired timers
+  Entry sentry(now, UINT32_MAX);
+  TimerList::iterator end = timers_.lower_bound(sentry);
+  expired_.clear();
+  for (TimerList::iterator it = timers_.begin(); it != end; ++it) {
+    Node &node = pool_.at(it->second);
+    if (node.canceled) {
+      --numCanceled_;
+      release(it->second);
+    } else {
+      node.state = kRunning;
+      expired_.push_back(*it);
+    }
+  }
+  timers_.erase(timers_.begin(), end);
+
+  // 回调中可能添加/取消定时器
+  for (const Entry &it : expired_) {
+    pool_.at(it.second).timer.run();
+  }
+
+  for (const Entry &it : expired_) {
+    Node &node = pool_.at(it.second);
+    if (node.timer.repeat() && !node.canceled) {
+      node.timer.restart(now);
+      node.state = kQueued;
+      insert(it.second);
+    } else {
+      release(it.second);
+    }
+  }
+  expired_.clear();
+
+  dropCanceledFront();
+  if (!timers_.empty()) {
+    resetTimerfd(timers_.begin()->first);
+  }
+}
+
+bool SortedTimerQueue::insert(uint32_t index) {
+  bool earliestChanged = false;
+  Timestamp when = pool_.at(index).timer.expiration();
+  TimerList::iterator it = timers_.begin();
+  if (it == timers_.end() || when < it->first) {
+    earliestChanged = true;
+  }
+  timers_.insert(Entry(when, index));
+  return earliestChanged;
+}
+
+void SortedTimerQueue::dropCanceledFront() {
+  while (!timers_.empty()) {
+    uint32_t index = timers_.begin()->second;
+    if (!pool_.at(index).canceled) {
+      break;
+    }
+    timers_.erase(timers_.begin());
+    --numCanceled_;
+    release(index);
+  }
+}
+
+void SortedTimerQueue::compact() {
+  for (TimerList::iterator it = timers_.begin(); it != timers_.end();) {
+    if (pool_.at(it->second).canceled) {
+      release(it->second);
+      it = timers_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  numCanceled_ = 0;
+}
+
+void SortedTimerQueue::release(uint32_t index) {
+  pool_.at(index).timer.clear();
+  pool_.release(index);
+}
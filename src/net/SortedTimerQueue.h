@@ -0,0 +1,65 @@
+#ifndef MYMUDUO_NET_SORTEDTIMERQUEUE_H
+#define MYMUDUO_NET_SORTEDTIMERQUEUE_H
+
+#include <set>
+#include <vector>
+
+#include "src/net/Timer.h"
+#include "src/net/TimerPool.h"
+#include "src/net/TimerQueue.h"
+
+namespace mymuduo {
+
+// 用按到期时间排序的std::set保存定时器，默认的TimerQueue实现
+// 取消已入队的定时器只标记它的槽位，不查找set：到期时丢弃，或者取消的定时器超过一半时
+// 一次清理，像"每条消息重设超时"这样不断取消远期定时器时set不会无限增长
+class SortedTimerQueue : public TimerQueue {
+public:
+  explicit SortedTimerQueue(EventLoop *loop);
+  ~SortedTimerQueue() override;
+
+  TimerId addTimer(TimerCallback cb, Timestamp when, double interval) override;
+  void cancel(TimerId timerId) override;
+  size_t size() const override { return pool_.size() - numCanceled_; }
+
+private:
+  enum State {
+    kPending, // 已分配，等待addTimerInLoop
+    kQueued,  // 在timers_中
+    kRunning, // 已到期，正在执行回调
+  };
+  struct Node {
+    Node() : state(kPending), canceled(false) {}
+    Timer timer;
+    State state;
+    bool canceled; // 被取消，kQueued状态下留在timers_中等待丢弃
+  };
+  // 已取消但还在timers_中的定时器不少于这个数并且超过一半时清理
+  static const size_t kMinCompaction = 1024;
+  // 到期时间和在pool_中的下标
+  using Entry = std::pair<Timestamp, uint32_t>;
+  using TimerList = std::set<Entry>;
+
+  void handleExpired(Timestamp now) override;
+
+  void addTimerInLoop(uint32_t index);
+  void cancelInLoop(TimerId timerId);
+
+  bool insert(uint32_t index);
+  void release(uint32_t index);
+  // 丢弃timers_开头已取消的定时器，让timerfd不为它们唤醒
+  void dropCanceledFront();
+  // 从timers_中移除所有已取消的定时器
+  void compact();
+
+private:
+  // Timer list sorted by expiration
+  TimerList timers_;
+  TimerPool<Node> pool_;
+  std::vector<Entry> expired_;
+  size_t numCanceled_; // 已取消但还在timers_中的定时器个数
+};
+
+} // namespace mymuduo
+
+#endif // MYMUDUO_NET_SORTEDTIMERQUEUE_H
@@ -22,7 +22,8 @@ TcpClient::TcpClient(EventLoop *loop, const InetAddress &serverAddr,
     : loop_(CheckLoopNotNull(loop)),
       connector_(std::make_shared<Connector>(loop, serverAddr)), name_(nameArg),
       connectionCallback_(TcpConnection::defaultConnectionCallback),
-      messageCallback_(TcpConnection::defaultMessageCallback) {
+      messageCallback_(TcpConnection::defaultMessageCallback),
+      nextConnId_(1) {
   connector_->setNewConnectionCallback(
       std::bind(&TcpClient::newConnection, this, std::placeholders::_1));
 }
@@ -71,14 +72,14 @@ void TcpClient::stop() {
 
 void TcpClient::newConnection(int sockfd) {
   InetAddress peerAddr(InetAddress::getPeerAddr(sockfd));
-  char buf[32]{0};
-  snprintf(buf, sizeof buf, ":%s#%d", peerAddr.toIpPort().c_str(),
-           nextConnId_++);
-  std::string connName = name_ + buf;
+  // 连接名字为"name:ip:port#id"
+  auto namePrefix =
+      std::make_shared<const std::string>(name_ + ':' + peerAddr.toIpPort());
 
   InetAddress localAddr(InetAddress::getLocalAddr(sockfd));
-  TcpConnectionPtr conn(std::make_shared<TcpConnection>(loop_, connName, sockfd,
-                                                        localAddr, peerAddr));
+  TcpConnectionPtr conn(std::make_shared<TcpConnection>(
+      loop_, nextConnId_++, std::move(namePrefix), sockfd, localAddr,
+      peerAddr));
   conn->setConnectionCallback(connectionCallback_);
   conn->setMessageCallback(messageCallback_);
   conn->setWriteCompleteCallback(writeCompleteCallback_);
@@ -50,7 +50,7 @@ private:
   WriteCompleteCallback writeCompleteCallback_;
   std::atomic_bool retry_;
   std::atomic_bool connect_;
-  int nextConnId_;
+  uint64_t nextConnId_;
   TcpConnectionPtr connection_;
   mutable std::mutex mutex_;
 };
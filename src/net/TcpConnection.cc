@@ -3,9 +3,13 @@
 #include "src/net/EventLoop.h"
 #include "src/net/Socket.h"
 
+#include <algorithm>
 #include <atomic>
 #include <errno.h>
 #include <functional>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
 #include <unistd.h>
 
 using namespace mymuduo;
@@ -19,15 +23,23 @@ static EventLoop *CheckLoopNotNull(EventLoop *loop) {
   return loop;
 }
 
-TcpConnection::TcpConnection(EventLoop *loop, const std::string &nameArg,
+TcpConnection::TcpConnection(EventLoop *loop, uint64_t id,
+                             std::shared_ptr<const std::string> namePrefix,
                              int sockfd, const InetAddress &localAddr,
                              const InetAddress &peerAddr)
-    : loop_(CheckLoopNotNull(loop)), name_(nameArg), state_(kConnecting),
-      reading_(true), socket_(new Socket(sockfd)),
+    : loop_(CheckLoopNotNull(loop)), id_(id),
+      namePrefix_(std::move(namePrefix)), state_(kConnecting),
+      reading_(true), edgeTriggered_(false),
+      edgeTriggeredBudget_(kDefaultEdgeTriggeredBudget), chainedOutput_(false),
+      zeroCopyThreshold_(0), autoCork_(false), flushQueued_(false),
+      corkedSends_(0), socket_(new Socket(sockfd)),
       channel_(new Channel(loop, sockfd)), localAddr_(localAddr),
       peerAddr_(peerAddr),
-      highWaterMark_(64 * 1024 * 1024) // 64M 避免发送太快对方接受太慢
-{
+      highWaterMark_(kDefaultHighWaterMark), lowWaterMark_(0),
+      aboveHighWaterMark_(false),
+      // 缓冲区只在有数据时从loop的内存池借用内存
+      inputBuffer_(loop_->bufferPool()), outputBuffer_(loop_->bufferPool()),
+      outputChain_(loop_->bufferPool()) {
   // 下面给channel设置相应的回调函数 poller给channel通知感兴趣的事件发生了
   // channel会回调相应的回调函数
   channel_->setReadCallback(
@@ -36,15 +48,22 @@ TcpConnection::TcpConnection(EventLoop *loop, const std::string &nameArg,
   channel_->setCloseCallback(std::bind(&TcpConnection::handleClose, this));
   channel_->setErrorCallback(std::bind(&TcpConnection::handleError, this));
 
-  LOG_INFO << "TcpConnection::ctor[" << name_.data() << "] at fd =" << sockfd;
+  LOG_INFO << "TcpConnection::ctor[" << name() << "] at fd =" << sockfd;
   socket_->setKeepAlive(true);
+  // 创建时就计入，同一批分配的连接还没建立时LoopSelector也能看到，
+  // connectDestroyed时减去
+  loop_->updateConnectionCount(1);
 }
 
 TcpConnection::~TcpConnection() {
-  LOG_INFO << "TcpConnection::dtor[" << name_ << "] at fd=" << channel_->fd()
+  LOG_INFO << "TcpConnection::dtor[" << name() << "] at fd=" << channel_->fd()
            << " state=" << stateToString();
 }
 
+std::string TcpConnection::name() const {
+  return *namePrefix_ + '#' + std::to_string(id_);
+}
+
 const char *TcpConnection::stateToString() const {
   switch (state_.load()) {
   case kDisconnected:
@@ -60,54 +79,269 @@ const char *TcpConnection::stateToString() const {
   }
 }
 
+// 在loop线程中直接发送，不拷贝消息也不构造闭包；其他线程的调用只在闭包中保存一份消息
 void TcpConnection::send(const void *data, size_t len) {
-  send(std::string(static_cast<const char *>(data), len));
+  if (state_ == kConnected) {
+    if (loop_->isInLoopThread()) {
+      sendInLoop(static_cast<const char *>(data), len);
+    } else {
+      send(std::string(static_cast<const char *>(data), len));
+    }
+  }
 }
 
 void TcpConnection::send(const std::string &msg) {
+  send(msg.data(), msg.size());
+}
+
+void TcpConnection::send(std::string &&msg) {
+  if (state_ == kConnected) {
+    if (loop_->isInLoopThread()) {
+      sendInLoop(msg.data(), msg.size());
+    } else {
+      // msg移入bind对象，跨线程不再拷贝
+      loop_->runInLoop(std::bind(&TcpConnection::sendStringInLoop, this,
+                                 std::move(msg)));
+    }
+  }
+}
+
+void TcpConnection::send(Buffer *buf) { send(std::move(*buf)); }
+
+void TcpConnection::send(Buffer &&buf) {
+  if (state_ == kConnected) {
+    if (loop_->isInLoopThread()) {
+      if (&buf == &outputBuffer_) {
+        // send(outputBuffer())，先把数据移出来
+        Buffer data(loop_->bufferPool());
+        data.takeAll(&buf);
+        sendBufferInLoop(&data);
+      } else {
+        sendBufferInLoop(&buf);
+      }
+    } else {
+      // 调用后buf为空；buf的内存属于本loop的内存池时直接接管，否则拷贝一次
+      std::shared_ptr<Buffer> data =
+          std::make_shared<Buffer>(loop_->bufferPool());
+      data->takeAll(&buf);
+      loop_->runInLoop([this, data] { sendBufferInLoop(data.get()); });
+    }
+  }
+}
+
+void TcpConnection::send(BufferChain *chain) {
   if (state_ == kConnected) {
-    loop_->runInLoop(std::bind(&TcpConnection::sendInLoop, this, msg));
+    if (loop_->isInLoopThread()) {
+      sendChainInLoop(chain);
+    } else {
+      std::shared_ptr<BufferChain> data(new BufferChain(loop_->bufferPool()));
+      data->splice(chain);
+      loop_->runInLoop([this, data] { sendChainInLoop(data.get()); });
+    }
   }
 }
 
-void TcpConnection::send(Buffer *buf) {
+void TcpConnection::send(const SharedPayload &payload) {
   if (state_ == kConnected) {
-    loop_->runInLoop(std::bind(&TcpConnection::sendInLoop, this,
-                               buf->retrieveAllAsString()));
+    if (loop_->isInLoopThread()) {
+      sendSharedInLoop(payload);
+    } else {
+      loop_->runInLoop([this, payload] { sendSharedInLoop(payload); });
+    }
+  }
+}
+
+void TcpConnection::sendFile(int fd, off_t offset, size_t len) {
+  if (state_ != kConnected) {
+    ::close(fd);
+    return;
+  }
+  if (loop_->isInLoopThread()) {
+    BufferChain chain(loop_->bufferPool());
+    chain.appendFile(fd, offset, len);
+    sendChainInLoop(&chain);
+  } else {
+    std::shared_ptr<BufferChain> chain(new BufferChain(loop_->bufferPool()));
+    chain->appendFile(fd, offset, len);
+    loop_->runInLoop([this, chain] { sendChainInLoop(chain.get()); });
+  }
+}
+
+// 没有待发送的数据时直接write，返回写出的字节数
+size_t TcpConnection::writeDirectly(const char *data, size_t len) {
+  if (autoCork_ || channel_->isWriting() || outputBytes() != 0) {
+    return 0;
+  }
+  ssize_t n = ::write(channel_->fd(), data, len);
+  if (n < 0) {
+    if (errno != EWOULDBLOCK) {
+      LOG_SYSERR << "TcpConnection::writeDirectly()";
+    }
+    return 0;
+  }
+  if (zeroCopyThreshold_ > 0) {
+    // 调用者的内存在返回后就可能被复用，不能零拷贝
+    loop_->mutableStats()->zeroCopyFallbackBytes.record(n);
+  }
+  if (static_cast<size_t>(n) == len) {
+    // 用户可能先在outputBuffer()中组装消息再send(outputBuffer())
+    outputBuffer_.releaseIfEmpty();
+    if (writeCompleteCallback_) {
+      loop_->queueInLoop(std::bind(
+          writeCompleteCallback_,
+          shared_from_this())); // queueInLoop会在下一次处理pendingFuncs时执行，runInLoop可能会直接执行
+    }
   }
+  return n;
 }
 
-void TcpConnection::sendInLoop(const std::string &message) {
+void TcpConnection::sendInLoop(const char *data, size_t len) {
   loop_->assertInLoopThread();
   if (state_ == kDisconnected) {
     LOG_WARN << "fd " << channel_->fd() << " disconnected, give up writing";
     return;
   }
 
-  ssize_t n = 0;
-  ssize_t remain = message.size();
-  if (!channel_->isWriting() &&
-      outputBuffer_.readableBytes() == 0) { // 没有待处理的写事件时直接write
-    n = ::write(channel_->fd(), message.c_str(), message.size());
+  size_t n = writeDirectly(data, len);
+  if (n < len) {
+    if (outputToChain()) {
+      outputChain_.append(data + n, len - n);
+    } else {
+      outputBuffer_.append(data + n, len - n);
+    }
+    scheduleWrite();
+  }
+}
+
+void TcpConnection::sendStringInLoop(const std::string &message) {
+  sendInLoop(message.data(), message.size());
+}
+
+void TcpConnection::sendBufferInLoop(Buffer *data) {
+  loop_->assertInLoopThread();
+  if (state_ == kDisconnected) {
+    LOG_WARN << "fd " << channel_->fd() << " disconnected, give up writing";
+    return;
+  }
+
+  data->retrieve(writeDirectly(data->peek(), data->readableBytes()));
+  if (data->readableBytes() > 0) {
+    if (outputToChain()) {
+      outputChain_.append(data->peek(), data->readableBytes());
+    } else {
+      // outputBuffer_为空且与data同属本loop的内存池时连同内存一起接管，不拷贝
+      outputBuffer_.takeAll(data);
+    }
+    data->retrieveAll();
+    scheduleWrite();
+  }
+}
+
+void TcpConnection::sendChainInLoop(BufferChain *chain) {
+  loop_->assertInLoopThread();
+  if (state_ == kDisconnected) {
+    LOG_WARN << "fd " << channel_->fd() << " disconnected, give up writing";
+    chain->retrieveAll();
+    return;
+  }
+
+  if (!autoCork_ && !channel_->isWriting() && outputBytes() == 0) {
+    if (zeroCopyThreshold_ > 0) {
+      // 零拷贝发送的块要留到完成通知到达，先转移到outputChain_再发送
+      outputChain_.splice(chain);
+      chain = &outputChain_;
+    }
+    int savedErrno = 0;
+    ssize_t n = chain->writeFd(channel_->fd(), &savedErrno);
     if (n >= 0) {
-      remain -= n;
-      if (remain == 0 && writeCompleteCallback_) {
-        loop_->queueInLoop(std::bind(
-            writeCompleteCallback_,
-            shared_from_this())); // queueInLoop会在下一次处理pendingFuncs时执行，runInLoop可能会直接执行
+      if (chain->readableBytes() == 0 && writeCompleteCallback_) {
+        loop_->queueInLoop(
+            std::bind(writeCompleteCallback_, shared_from_this()));
       }
+    } else if (savedErrno != EWOULDBLOCK) {
+      errno = savedErrno;
+      LOG_SYSERR << "TcpConnection::sendChainInLoop()";
+    }
+  }
+
+  if (chain->readableBytes() > 0) {
+    if (outputToChain() || chain->numFileRanges() > 0) {
+      outputChain_.splice(chain);
     } else {
-      if (errno != EWOULDBLOCK) {
-        LOG_SYSERR << "TcpConnection::sendInLoop()";
-      }
+      chain->retrieveAllInto(&outputBuffer_);
     }
+    scheduleWrite();
   }
+}
 
-  if (remain > 0) {
-    outputBuffer_.append(message.data() + n, remain);
-    if (!channel_->isWriting()) {
-      channel_->enableWriting();
+void TcpConnection::sendSharedInLoop(const SharedPayload &payload) {
+  loop_->assertInLoopThread();
+  if (state_ == kDisconnected) {
+    LOG_WARN << "fd " << channel_->fd() << " disconnected, give up writing";
+    return;
+  }
+
+  if (zeroCopyThreshold_ > 0) {
+    // 块在完成通知到达前保持着payload的引用，可以零拷贝发送
+    BufferChain chain(loop_->bufferPool());
+    chain.appendShared(payload);
+    sendChainInLoop(&chain);
+    return;
+  }
+  size_t n = writeDirectly(payload->data(), payload->size());
+  if (n < payload->size()) {
+    // 排在outputBuffer_中已有的数据之后，之后的send也会进入outputChain_
+    outputChain_.appendShared(payload, n, payload->size() - n);
+    scheduleWrite();
+  }
+}
+
+// 数据已经放入outputBuffer_/outputChain_，等待可写通知或本轮末尾的flushOutput
+void TcpConnection::scheduleWrite() {
+  checkHighWaterMark();
+  if (channel_->isWriting()) {
+    return;
+  }
+  if (autoCork_) {
+    ++corkedSends_;
+    if (!flushQueued_) {
+      flushQueued_ = true;
+      loop_->queueFlush(shared_from_this());
     }
+  } else {
+    channel_->enableWriting();
+  }
+}
+
+void TcpConnection::flushOutput() {
+  loop_->assertInLoopThread();
+  flushQueued_ = false;
+  if (corkedSends_ > 0) {
+    loop_->mutableStats()->corkedSends.record(corkedSends_);
+    corkedSends_ = 0;
+  }
+  // 连接已经关闭，或者已经在等待可写通知
+  if (state_ == kDisconnected || channel_->isWriting() || outputBytes() == 0) {
+    return;
+  }
+  size_t attempted = 0;
+  int savedErrno = 0;
+  ssize_t n = writeOutput(outputBytes(), &attempted, &savedErrno);
+  if (n < 0 && savedErrno != EWOULDBLOCK) {
+    errno = savedErrno;
+    LOG_SYSERR << "TcpConnection::flushOutput()";
+  }
+  checkLowWaterMark();
+  if (outputBytes() > 0) {
+    channel_->enableWriting();
+    return;
+  }
+  outputBuffer_.releaseIfEmpty();
+  if (writeCompleteCallback_) {
+    loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+  }
+  if (state_ == kDisconnecting) {
+    shutdownInLoop();
   }
 }
 
@@ -121,8 +355,8 @@ void TcpConnection::shutdown() {
 
 void TcpConnection::shutdownInLoop() {
   loop_->assertInLoopThread();
-  // 当前outputBuffer_的数据全部向外发送完成
-  if (!channel_->isWriting()) {
+  // 当前outputBuffer_的数据全部向外发送完成，合并发送时数据可能还在等本轮末尾的flushOutput
+  if (!channel_->isWriting() && outputBytes() == 0) {
     socket_->shutdown();
   }
 }
@@ -132,7 +366,30 @@ void TcpConnection::connectEstablished() {
   assert(state_ == kConnecting);
   setState(kConnected);
   channel_->tie(shared_from_this());
-  channel_->enableReading(); // channel -> EPOLLIN
+  if (edgeTriggered_) {
+    if (loop_->supportsEdgeTriggered()) {
+      channel_->setEdgeTriggered(true);
+    } else {
+      LOG_DEBUG << "TcpConnection::connectEstablished [" << name()
+                << "] poller does not support edge-triggered mode";
+    }
+  }
+  if (loop_->busyPollMaxUs() > 0) {
+    socket_->setBusyPoll(loop_->busyPollMaxUs());
+  }
+  if (zeroCopyThreshold_ > 0) {
+    if (socket_->setZeroCopy(true)) {
+      outputChain_.enableZeroCopy(zeroCopyThreshold_, loop_->mutableStats());
+    } else {
+      zeroCopyThreshold_ = 0;
+    }
+  }
+  if (reading_) {
+    channel_->enableReading(); // channel -> EPOLLIN
+  } else {
+    // 连接建立前就调用了stopRead，只注册到poller以便之后切换事件
+    channel_->disableReading();
+  }
 
   // new connection callback
   connectionCallback_(shared_from_this());
@@ -140,12 +397,32 @@ void TcpConnection::connectEstablished() {
 
 void TcpConnection::connectDestroyed() {
   loop_->assertInLoopThread();
-  if (state_ == kConnected) {
+  // 不能等到析构：TcpConnectionPtr可能被用户持有到loop析构之后
+  loop_->updateConnectionCount(-1);
+  // TcpServer析构时连接可能还没关闭，包括已经shutdown、在等对端关闭的连接
+  if (state_ == kConnected || state_ == kDisconnecting) {
     setState(kDisconnected);
     channel_->disableAll(); // 把channel的所有感兴趣的事件从poller中删除掉
     connectionCallback_(shared_from_this());
   }
   channel_->remove(); // 把channel从poller中删除掉
+  // 在loop线程把缓冲区内存还给内存池
+  inputBuffer_.retrieveAll();
+  inputBuffer_.releaseIfEmpty();
+  outputBuffer_.retrieveAll();
+  outputBuffer_.releaseIfEmpty();
+  outputChain_.retrieveAll();
+  if (outputChain_.numPinnedBlocks() > 0) {
+    // 关闭socket后就收不到完成通知了，块连同dup出的fd交给loop，通知全部到达后再释放
+    int fd = ::dup(channel_->fd());
+    if (fd >= 0) {
+      std::unique_ptr<BufferChain> chain(new BufferChain(loop_->bufferPool()));
+      chain->swap(outputChain_);
+      loop_->adoptZeroCopyChain(fd, std::move(chain));
+    } else {
+      LOG_SYSERR << "TcpConnection::connectDestroyed [" << name() << "] dup";
+    }
+  }
 }
 
 void TcpConnection::forceClose() {
@@ -168,15 +445,52 @@ void TcpConnection::forceCloseInLoop() {
 
 void TcpConnection::setTcpNoDelay(bool on) { socket_->setTcpNoDelay(on); }
 
+void TcpConnection::startRead() {
+  loop_->runInLoop(
+      std::bind(&TcpConnection::startReadInLoop, shared_from_this()));
+}
+
+void TcpConnection::startReadInLoop() {
+  loop_->assertInLoopThread();
+  if (!reading_) {
+    reading_ = true;
+    // 重新注册时epoll会检查当前是否可读，ET模式下暂停期间到达的数据也会通知
+    if (state_ == kConnected || state_ == kDisconnecting) {
+      channel_->enableReading();
+    }
+  }
+}
+
+void TcpConnection::stopRead() {
+  loop_->runInLoop(
+      std::bind(&TcpConnection::stopReadInLoop, shared_from_this()));
+}
+
+void TcpConnection::stopReadInLoop() {
+  loop_->assertInLoopThread();
+  if (reading_) {
+    reading_ = false;
+    if (channel_->isReading()) {
+      channel_->disableReading();
+    }
+  }
+}
+
 void TcpConnection::handleRead(Timestamp receiveTime) {
   loop_->assertInLoopThread();
+  if (channel_->isEdgeTriggered()) {
+    handleReadEdgeTriggered(receiveTime);
+    return;
+  }
   int savedErrno = 0;
   // TcpConnection会从socket读取数据，然后写入inpuBuffer
-  ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+  ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno, &readSize_);
   if (n > 0) {
+    recordRead(n);
     // 已建立连接的用户，有可读事件发生，调用用户传入的回调操作
     // TODO:shared_from_this
     messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+    inputBuffer_.releaseIfEmpty();
   } else if (n == 0) {
     // 没有数据，说明客户端关闭连接
     handleClose();
@@ -187,25 +501,78 @@ void TcpConnection::handleRead(Timestamp receiveTime) {
   }
 }
 
+void TcpConnection::handleReadEdgeTriggered(Timestamp receiveTime) {
+  // 预算用完后排队的后续读取可能晚于连接关闭或stopRead执行
+  if (state_ == kDisconnected || !reading_) {
+    return;
+  }
+  size_t total = 0;
+  bool drained = false;
+  bool peerClosed = false;
+  int savedErrno = 0;
+  while (total < edgeTriggeredBudget_) {
+    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno, &readSize_);
+    if (n > 0) {
+      recordRead(n);
+      total += n;
+    } else if (n == 0) {
+      peerClosed = true;
+      break;
+    } else if (savedErrno == EINTR) {
+      continue;
+    } else {
+      if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) {
+        drained = true;
+      } else {
+        errno = savedErrno;
+        LOG_SYSERR << "TcpConnection::handleReadEdgeTriggered() failed";
+      }
+      break;
+    }
+  }
+
+  if (total > 0) {
+    messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+    inputBuffer_.releaseIfEmpty();
+  }
+  if (peerClosed) {
+    if (state_ == kConnected || state_ == kDisconnecting) {
+      handleClose();
+    }
+  } else if (!drained && total >= edgeTriggeredBudget_) {
+    // ET模式下不会再有新的通知，剩余数据放到本轮末尾继续读
+    loop_->queueInLoop(std::bind(&TcpConnection::handleReadEdgeTriggered,
+                                 shared_from_this(), receiveTime));
+  }
+}
+
+void TcpConnection::recordRead(size_t n) {
+  EventLoopStats *stats = loop_->mutableStats();
+  stats->readBytes.record(n);
+  if (readSize_.lastSpilled() > 0) {
+    stats->readSpillBytes.record(readSize_.lastSpilled());
+  }
+}
+
 void TcpConnection::handleWrite() {
   loop_->assertInLoopThread();
+  if (channel_->isEdgeTriggered()) {
+    handleWriteEdgeTriggered();
+    return;
+  }
 
   if (channel_->isWriting()) { // 这里也可用 kConnected | kDisconnecting判断
-    ssize_t n = ::write(channel_->fd(), outputBuffer_.peek(),
-                        outputBuffer_.readableBytes());
-    if (n > 0) {
-      outputBuffer_.retrieve(n);
-      if (outputBuffer_.readableBytes() == 0) {
-        channel_->disableWriting();
-        if (writeCompleteCallback_) {
-          loop_->queueInLoop(
-              std::bind(writeCompleteCallback_, shared_from_this()));
-        }
-        if (state_ == kDisconnecting) {
-          shutdownInLoop();
-        }
+    size_t attempted = 0;
+    int savedErrno = 0;
+    ssize_t n = writeOutput(outputBytes(), &attempted, &savedErrno);
+    // 丢弃了被截断的文件区间时返回0
+    if (n >= 0) {
+      checkLowWaterMark();
+      if (outputBytes() == 0) {
+        writeCompleted();
       }
     } else {
+      errno = savedErrno;
       LOG_SYSERR << "TcpConnection::handleWrite()";
     }
   } else { // 写之前对方就关闭了连接，服务端调用TcpConnection::handleClose()关闭了channel
@@ -214,6 +581,99 @@ void TcpConnection::handleWrite() {
   }
 }
 
+void TcpConnection::handleWriteEdgeTriggered() {
+  // ET模式下每次变为可写都会通知，与是否有待发送数据无关
+  if (!channel_->isWriting()) {
+    return;
+  }
+  size_t total = 0;
+  while (outputBytes() > 0 && total < edgeTriggeredBudget_) {
+    size_t attempted = 0;
+    int savedErrno = 0;
+    ssize_t n = writeOutput(edgeTriggeredBudget_ - total, &attempted,
+                            &savedErrno);
+    if (n >= 0) {
+      total += n;
+      if (static_cast<size_t>(n) < attempted) {
+        // 发送缓冲区已满，等待下一次可写通知
+        break;
+      }
+    } else if (savedErrno == EINTR) {
+      continue;
+    } else {
+      if (savedErrno != EAGAIN && savedErrno != EWOULDBLOCK) {
+        errno = savedErrno;
+        LOG_SYSERR << "TcpConnection::handleWriteEdgeTriggered()";
+      }
+      break;
+    }
+  }
+
+  checkLowWaterMark();
+  if (outputBytes() == 0) {
+    writeCompleted();
+  } else if (total >= edgeTriggeredBudget_) {
+    loop_->queueInLoop(std::bind(&TcpConnection::handleWriteEdgeTriggered,
+                                 shared_from_this()));
+  }
+}
+
+ssize_t TcpConnection::writeOutput(size_t maxBytes, size_t *attempted,
+                                   int *savedErrno) {
+  if (outputBuffer_.readableBytes() == 0) {
+    return outputChain_.writeFd(channel_->fd(), savedErrno, maxBytes,
+                                attempted);
+  }
+  *attempted = std::min(outputBuffer_.readableBytes(), maxBytes);
+  ssize_t n = ::write(channel_->fd(), outputBuffer_.peek(), *attempted);
+  if (n > 0) {
+    outputBuffer_.retrieve(n);
+  } else if (n < 0) {
+    *savedErrno = errno;
+  }
+  return n;
+}
+
+void TcpConnection::checkHighWaterMark() {
+  if (aboveHighWaterMark_ || outputBytes() < highWaterMark_) {
+    return;
+  }
+  aboveHighWaterMark_ = true;
+  if (TcpConnectionPtr source = backpressureSource_.lock()) {
+    source->stopRead();
+  }
+  if (highWaterMarkCallback_) {
+    loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(),
+                                 outputBytes()));
+  }
+}
+
+void TcpConnection::checkLowWaterMark() {
+  if (!aboveHighWaterMark_ || outputBytes() > lowWaterMark_) {
+    return;
+  }
+  aboveHighWaterMark_ = false;
+  if (TcpConnectionPtr source = backpressureSource_.lock()) {
+    source->startRead();
+  }
+  if (lowWaterMarkCallback_) {
+    loop_->queueInLoop(std::bind(lowWaterMarkCallback_, shared_from_this(),
+                                 outputBytes()));
+  }
+}
+
+// outputBuffer_中的数据全部发送完毕
+void TcpConnection::writeCompleted() {
+  channel_->disableWriting();
+  outputBuffer_.releaseIfEmpty();
+  if (writeCompleteCallback_) {
+    loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+  }
+  if (state_ == kDisconnecting) {
+    shutdownInLoop();
+  }
+}
+
 void TcpConnection::handleClose() {
   loop_->assertInLoopThread();
   LOG_TRACE << "handleClose fd = " << channel_->fd()
@@ -228,15 +688,26 @@ void TcpConnection::handleClose() {
 }
 
 void TcpConnection::handleError() {
+  if (zeroCopyThreshold_ > 0) {
+    handleErrorQueue();
+  }
   int err;
   socklen_t errlen = sizeof(err);
   if (::getsockopt(channel_->fd(), SOL_SOCKET, SO_ERROR, &err, &errlen) < 0) {
     err = errno;
   }
-  LOG_ERROR << "TcpConnection::handleError [" << name_
+  if (zeroCopyThreshold_ > 0 && err == 0) {
+    // 只是零拷贝的完成通知
+    return;
+  }
+  LOG_ERROR << "TcpConnection::handleError [" << name()
             << "]: SO_ERROR = " << err;
 }
 
+void TcpConnection::handleErrorQueue() {
+  outputChain_.readZeroCopyCompletions(channel_->fd());
+}
+
 void TcpConnection::defaultConnectionCallback(const TcpConnectionPtr &conn) {
   LOG_TRACE << conn->localAddress().toIpPort() << " -> "
             << conn->peerAddress().toIpPort() << " is "
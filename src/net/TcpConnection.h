@@ -5,6 +5,7 @@
 #include "src/base/noncopyable.h"
 #include "src/logger/Logging.h"
 #include "src/net/Buffer.h"
+#include "src/net/BufferChain.h"
 #include "src/net/Callbacks.h"
 #include "src/net/InetAddress.h"
 #include "src/http/HttpConnection.h"
@@ -22,20 +23,44 @@ class Socket;
 class TcpConnection : noncopyable,
                       public std::enable_shared_from_this<TcpConnection> {
 public:
-  TcpConnection(EventLoop *loop, const std::string &nameArg, int sockfd,
+  // ET模式下每次唤醒最多读/写的字节数，避免一个连接独占loop
+  static const size_t kDefaultEdgeTriggeredBudget = 256 * 1024;
+  // 小于这个大小时MSG_ZEROCOPY的页面锁定和完成通知比拷贝还贵
+  static const size_t kDefaultZeroCopyThreshold = 32 * 1024;
+  // 避免发送太快对方接收太慢
+  static const size_t kDefaultHighWaterMark = 64 * 1024 * 1024;
+
+  // 名字为"namePrefix#id"，只在用到时(如日志)才拼接；同一个服务器的连接共用namePrefix
+  TcpConnection(EventLoop *loop, uint64_t id,
+                std::shared_ptr<const std::string> namePrefix, int sockfd,
                 const InetAddress &localAddr, const InetAddress &peerAddr);
   ~TcpConnection();
 
   EventLoop *getLoop() const { return loop_; }
-  const std::string &name() const { return name_; }
+  // 在创建它的TcpServer/TcpClient中唯一
+  uint64_t id() const { return id_; }
+  std::string name() const;
   const InetAddress &localAddress() const { return localAddr_; }
   const InetAddress &peerAddress() const { return peerAddr_; }
 
   bool connected() const { return state_ == kConnected; }
 
+  // 在loop线程调用时直接write，不拷贝消息；在其他线程调用时拷贝一次
   void send(const std::string &msg);
   void send(const void *msg, size_t len);
+  // 移入消息，在其他线程调用也不拷贝
+  void send(std::string &&msg);
+  // 取走buf中的数据，调用后buf为空；未发完的部分连同内存一起交给outputBuffer_
   void send(Buffer *buf);
+  void send(Buffer &&buf);
+  // 转移chain中的数据块，调用后chain为空；开启chainedOutput时未发完的部分不再拷贝
+  void send(BufferChain *chain);
+  // 发送不可变的共享消息，未发完的部分以引用挂在outputChain_上，不拷贝，
+  // 同一条消息广播给多个连接时每个连接只增加一次引用计数
+  void send(const SharedPayload &payload);
+  // 用sendfile发送文件fd中[offset, offset + len)的内容，文件内容不经过用户态内存，
+  // 与前后send的数据保持顺序。fd由连接接管，发送完或连接关闭时close
+  void sendFile(int fd, off_t offset, size_t len);
 
   void shutdown();
 
@@ -43,6 +68,45 @@ public:
 
   void setTcpNoDelay(bool on);
 
+  // 暂停/恢复读socket，暂停期间对端的数据留在内核缓冲区中，由TCP流控限速；
+  // 可以在任意线程调用
+  void startRead();
+  void stopRead();
+  // 只在loop线程中准确
+  bool isReading() const { return reading_; }
+
+  // 以EPOLLET注册连接，需要在connectEstablished之前设置
+  // Poller不支持ET时(如io_uring)仍然工作在LT模式
+  void setEdgeTriggered(bool on,
+                        size_t budget = kDefaultEdgeTriggeredBudget) {
+    edgeTriggered_ = on;
+    edgeTriggeredBudget_ = budget;
+  }
+
+  // 未发完的数据存放在BufferChain中而不是outputBuffer_，以writev发送，
+  // 大块数据不会因Buffer扩容而重复拷贝，需要在connectEstablished之前设置
+  void setChainedOutput(bool on) { chainedOutput_ = on; }
+
+  // 自动合并发送：send只把数据追加到发送缓冲区，本轮事件处理和doPendingFunctors结束后
+  // 由EventLoop统一发送一次，一轮中的多次send(如响应行、响应头、响应体)只用一次系统调用。
+  // 代价是数据最晚在本轮末尾才写出
+  void setAutoCork(bool on) { autoCork_ = on; }
+
+  // outputChain_中的数据一次发送不少于threshold字节时以MSG_ZEROCOPY发送，省去拷贝到内核的开销，
+  // 块在完成通知到达前不会释放；同时开启chainedOutput，需要在connectEstablished之前设置。
+  // 只有BufferChain中的数据能零拷贝，send(data, len)等直接写出的部分仍然拷贝，
+  // 两者的字节数记录在EventLoopStats的zeroCopy*中
+  void setZeroCopy(size_t threshold = kDefaultZeroCopyThreshold) {
+    zeroCopyThreshold_ = threshold;
+    if (threshold > 0) {
+      chainedOutput_ = true;
+    }
+  }
+
+  // 每次读socket前用FIONREAD查询可读的字节数，据此预留inputBuffer_的空间
+  // 多一次系统调用，适合数据量波动大的连接，见ReadSizePredictor
+  void setQueryFionread(bool on) { readSize_.setQueryFionread(on); }
+
   void setConnectionCallback(const ConnectionCallback &cb) {
     connectionCallback_ = cb;
   }
@@ -53,8 +117,29 @@ public:
     writeCompleteCallback_ = cb;
   }
 
-  void setHighWaterMarkCallback(const HighWaterMarkCallback &cb) {
+  // 待发送的数据从低于highWaterMark增长到不低于highWaterMark时回调一次
+  void setHighWaterMarkCallback(const HighWaterMarkCallback &cb,
+                                size_t highWaterMark = kDefaultHighWaterMark) {
     highWaterMarkCallback_ = cb;
+    highWaterMark_ = highWaterMark;
+  }
+
+  // 超过高水位后，待发送的数据降到不高于lowWaterMark时回调一次
+  void setLowWaterMarkCallback(const LowWaterMarkCallback &cb,
+                               size_t lowWaterMark) {
+    lowWaterMarkCallback_ = cb;
+    lowWaterMark_ = lowWaterMark;
+  }
+
+  // 待发送的数据超过highWaterMark时暂停source的读，降到lowWaterMark以下时恢复，
+  // 慢速的接收方不再让发送缓冲区无限增长。source可以是本连接(请求-响应型的服务)，
+  // 也可以是代理中另一个连接(可以属于别的loop)；只保存source的weak_ptr。
+  // 与高/低水位回调共用同一对水位，在本连接的loop线程或connectEstablished之前调用
+  void setBackpressure(const TcpConnectionPtr &source, size_t highWaterMark,
+                       size_t lowWaterMark) {
+    backpressureSource_ = source;
+    highWaterMark_ = highWaterMark;
+    lowWaterMark_ = lowWaterMark;
   }
 
   void setCloseCallback(const CloseCallback &cb) { closeCallback_ = cb; }
@@ -69,6 +154,8 @@ public:
   // TcpServer会调用
   void connectEstablished(); // 连接建立
   void connectDestroyed();   // 连接销毁
+  // EventLoop在本轮末尾调用，发送合并的数据
+  void flushOutput();
 
   static void defaultConnectionCallback(const TcpConnectionPtr &conn);
   static void defaultMessageCallback(const TcpConnectionPtr &conn, Buffer *buf,
@@ -78,20 +165,56 @@ private:
   enum StateE { kDisconnected, kConnecting, kConnected, kDisconnecting };
   void setState(StateE state) { state_.store(state); }
   const char *stateToString() const;
-  void sendInLoop(const std::string& message);
+  void sendInLoop(const char *data, size_t len);
+  void sendStringInLoop(const std::string &message);
+  void sendBufferInLoop(Buffer *data);
+  void sendChainInLoop(BufferChain *chain);
+  void sendSharedInLoop(const SharedPayload &payload);
   void shutdownInLoop();
   void forceCloseInLoop();
+  void startReadInLoop();
+  void stopReadInLoop();
 
   void handleRead(Timestamp receiveTime);
   void handleWrite();
+  // ET模式下读/写直到EAGAIN或用完本次唤醒的预算
+  void handleReadEdgeTriggered(Timestamp receiveTime);
+  void handleWriteEdgeTriggered();
+  void recordRead(size_t n);
+  void scheduleWrite();
+  void writeCompleted();
+  // 待发送数据增加/减少后检查是否越过高/低水位
+  void checkHighWaterMark();
+  void checkLowWaterMark();
+  size_t writeDirectly(const char *data, size_t len);
+  // 待发送的数据先出outputBuffer_，再出outputChain_；
+  // outputChain_中有数据(如文件区间)时，之后的数据也必须排在它后面
+  size_t outputBytes() const {
+    return outputBuffer_.readableBytes() + outputChain_.readableBytes();
+  }
+  bool outputToChain() const {
+    return chainedOutput_ || outputChain_.readableBytes() > 0;
+  }
+  // 从outputBuffer_/outputChain_写出最多maxBytes字节
+  ssize_t writeOutput(size_t maxBytes, size_t *attempted, int *savedErrno);
   void handleClose();
   void handleError();
+  // 读出错误队列中的MSG_ZEROCOPY完成通知
+  void handleErrorQueue();
 
 private:
   EventLoop *loop_;
-  const std::string name_;
+  const uint64_t id_;
+  const std::shared_ptr<const std::string> namePrefix_;
   std::atomic<TcpConnection::StateE> state_;
   bool reading_;
+  bool edgeTriggered_;
+  size_t edgeTriggeredBudget_;
+  bool chainedOutput_;
+  size_t zeroCopyThreshold_; // 0表示不使用MSG_ZEROCOPY
+  bool autoCork_;
+  bool flushQueued_;    // 已经登记到EventLoop等待本轮末尾发送
+  size_t corkedSends_;  // 本轮合并的send次数
   HttpConnectionPtr context_;
 
   std::unique_ptr<Socket> socket_;
@@ -109,11 +232,17 @@ private:
   WriteCompleteCallback writeCompleteCallback_; // 消息发送完成以后的回调
   CloseCallback closeCallback_; // 客户端关闭连接的回调
 
-  HighWaterMarkCallback highWaterMarkCallback_; // 超出水位实现的回调
+  HighWaterMarkCallback highWaterMarkCallback_; // 超出高水位时的回调
+  LowWaterMarkCallback lowWaterMarkCallback_;   // 从高水位回落到低水位时的回调
   size_t highWaterMark_;
+  size_t lowWaterMark_;
+  bool aboveHighWaterMark_;                // 越过了高水位，还没有回落到低水位
+  std::weak_ptr<TcpConnection> backpressureSource_; // 越过高水位时暂停读的连接
 
+  ReadSizePredictor readSize_; // 预测下一次读socket需要的空间
   Buffer inputBuffer_;  // 读取数据的缓冲区
   Buffer outputBuffer_; // 发送数据的缓冲区
+  BufferChain outputChain_; // chainedOutput_时发送数据的缓冲区，以及文件区间
 };
 } // namespace mymuduo
 #endif // MYMUDUO_NET_TCPCONNECTION_H
@@ -1,6 +1,10 @@
 #include "src/net/TcpServer.h"
+#include "src/base/CpuAffinity.h"
 #include "src/logger/Logging.h"
 #include "src/net/TcpConnection.h"
+
+#include <future>
+
 using namespace mymuduo;
 
 static EventLoop *CheckLoopNotNull(EventLoop *loop) {
@@ -16,27 +20,31 @@ TcpServer::TcpServer(EventLoop *loop, const InetAddress &listenAddr,
                      const std::string &nameArg, Option option)
     : loop_(loop), ipPort_(listenAddr.toIpPort()),
       name_(nameArg),
-      acceptor_(new Acceptor(loop, listenAddr, option == kReusePort)),
+      connNamePrefix_(
+          std::make_shared<const std::string>(name_ + '-' + ipPort_)),
+      listenAddr_(listenAddr), option_(option),
+      acceptor_(new Acceptor(loop, listenAddr, option != kNoReusePort)),
+      acceptBatchSize_(Acceptor::kDefaultBatchSize),
       threadPool_(new EventLoopThreadPool(loop, name_)), connectionCallback_(),
       messageCallback_(), writeCompleteCallback_(), threadInitCallback_(),
-      started_(0), nextConnId_(1) {
+      started_(0), nextConnId_(1), edgeTriggered_(false),
+      edgeTriggeredBudget_(TcpConnection::kDefaultEdgeTriggeredBudget),
+      chainedOutput_(false), zeroCopyThreshold_(0),
+      autoCork_(false), backpressureHighWaterMark_(0),
+      backpressureLowWaterMark_(0) {
   // 当有新用户连接时，Acceptor类中绑定的acceptChannel_会有读事件发生执行handleRead()调用TcpServer::newConnection回调
   acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this,
                                                 std::placeholders::_1,
                                                 std::placeholders::_2));
+  acceptor_->setBatchEndCallback(
+      std::bind(&TcpServer::dispatchConnections, this));
 }
 
 TcpServer::~TcpServer() {
   loop_->assertInLoopThread();
   LOG_TRACE << "TcpServer::~TcpServer [" << name_ << "] dtor";
-  for (auto &item : connections_) {
-    TcpConnectionPtr conn(item.second);
-    // 把原始的智能指针复位 让栈空间的TcpConnectionPtr conn指向该对象
-    // 当conn出了其作用域 即可释放智能指针指向的对象
-    item.second.reset();
-    // 销毁连接
-    conn->getLoop()->runInLoop(
-        std::bind(&TcpConnection::connectDestroyed, conn));
+  for (auto &shard : shards_) {
+    destroyShard(shard.get());
   }
 }
 
@@ -47,6 +55,16 @@ void TcpServer::setThreadNum(int numThreads) {
   threadPool_->setThreadNum(numThreads);
 }
 
+void TcpServer::setNumaNodeOfInterface(const std::string &ifname) {
+  int node = CpuAffinity::numaNodeOfInterface(ifname);
+  if (node < 0) {
+    LOG_INFO << "TcpServer::setNumaNodeOfInterface [" << name_ << "] - "
+             << ifname << " has no NUMA node";
+    return;
+  }
+  threadPool_->setNumaNode(node);
+}
+
 // 开启服务器监听
 void TcpServer::start() {
   if (started_ == 0) {
@@ -54,6 +72,26 @@ void TcpServer::start() {
     // 启动底层的lopp线程池
     threadPool_->start(threadInitCallback_);
     assert(!acceptor_->listening());
+    std::vector<EventLoop *> loops = threadPool_->getAllLoops();
+    for (EventLoop *ioLoop : loops) {
+      std::unique_ptr<LoopShard> shard(new LoopShard);
+      shard->loop = ioLoop;
+      shard->numConnections = 0;
+      shards_.push_back(std::move(shard));
+    }
+    if (option_ == kReusePortPerLoop && loops.front() != loop_) {
+      // acceptor_只占住端口不监听，新连接由内核分给各个subLoop的监听socket
+      for (auto &shard : shards_) {
+        shard->acceptor.reset(new Acceptor(shard->loop, listenAddr_, true));
+        shard->acceptor->setBatchSize(acceptBatchSize_);
+        shard->acceptor->setNewConnectionCallback(
+            std::bind(&TcpServer::newConnectionInLoop, this, shard.get(),
+                      std::placeholders::_1, std::placeholders::_2));
+        shard->loop->runInLoop(
+            std::bind(&Acceptor::listen, shard->acceptor.get()));
+      }
+      return;
+    }
     // acceptor_.get()绑定时候需要地址
     loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
   }
@@ -63,47 +101,138 @@ void TcpServer::start() {
 // 有一个新用户连接，acceptor会执行这个回调操作，负责将mainLoop接收到的请求连接(acceptChannel_会有读事件发生)通过回调轮询分发给subLoop去处理
 void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr) {
   loop_->assertInLoopThread();
-  // 轮询算法 选择一个subLoop 来管理connfd对应的channel
-  EventLoop *ioLoop = threadPool_->getNextLoop();
-  // 提示信息
-  char buf[64];
-  snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
-  // 这里没有设置为原子类是因为其只在mainloop中执行 不涉及线程安全问题
-  ++nextConnId_;
-  // 新连接名字
-  std::string connName = name_ + buf;
+  // 按LoopSelector(默认轮询)选择一个subLoop 来管理connfd对应的channel
+  EventLoop *ioLoop = threadPool_->getLoopForConnection(peerAddr);
+  TcpConnectionPtr conn = createConnection(ioLoop, sockfd, peerAddr);
+  // 连接在subLoop中登记，这里只暂存到本批accept结束
+  shardOf(ioLoop)->pendingConnections.push_back(std::move(conn));
+}
 
-  LOG_INFO << "TcpServer::newConnection [" << name_ << "] - new connection ["
-           << connName << "] from " << peerAddr.toIpPort();
+void TcpServer::dispatchConnections() {
+  loop_->assertInLoopThread();
+  for (auto &shard : shards_) {
+    if (shard->pendingConnections.empty()) {
+      continue;
+    }
+    // 一批连接只唤醒一次subLoop
+    LoopShard *s = shard.get();
+    auto conns = std::make_shared<std::vector<TcpConnectionPtr>>();
+    conns->swap(s->pendingConnections);
+    s->loop->runInLoop([this, s, conns] {
+      for (const TcpConnectionPtr &conn : *conns) {
+        establishConnection(s, conn);
+      }
+    });
+  }
+}
 
+// kReusePortPerLoop：连接在accept它的subLoop中建立，不经过baseLoop
+void TcpServer::newConnectionInLoop(LoopShard *shard, int sockfd,
+                                    const InetAddress &peerAddr) {
+  shard->loop->assertInLoopThread();
+  establishConnection(shard, createConnection(shard->loop, sockfd, peerAddr));
+}
+
+void TcpServer::establishConnection(LoopShard *shard,
+                                    const TcpConnectionPtr &conn) {
+  shard->loop->assertInLoopThread();
+  shard->connections[conn->id()] = conn;
+  shard->numConnections.fetch_add(1, std::memory_order_relaxed);
+  // 设置了如何关闭连接的回调，关闭时直接在本loop中移除，不经过baseLoop
+  conn->setCloseCallback(std::bind(&TcpServer::removeConnection, this, shard,
+                                   std::placeholders::_1));
+  conn->connectEstablished();
+}
+
+TcpConnectionPtr TcpServer::createConnection(EventLoop *ioLoop, int sockfd,
+                                             const InetAddress &peerAddr) {
   // 通过sockfd获取其绑定的本机的ip地址和端口信息
   InetAddress localAddr(InetAddress::getLocalAddr(sockfd));
-  TcpConnectionPtr conn(
-      new TcpConnection(ioLoop, connName, sockfd, localAddr, peerAddr));
-  connections_[connName] = conn;
+  // 新连接只记录整数id，名字在用到时才拼接
+  TcpConnectionPtr conn(new TcpConnection(ioLoop, nextConnId_++,
+                                          connNamePrefix_, sockfd, localAddr,
+                                          peerAddr));
+  LOG_INFO << "TcpServer::newConnection [" << name_ << "] - new connection ["
+           << conn->name() << "] from " << peerAddr.toIpPort();
   // 下面的回调都是用户设置给TcpServer =>
   // TcpConnection的，至于Channel绑定的则是TcpConnection设置的四个，handleRead,handleWrite...
   // 这下面的回调用于handlexxx函数中
   conn->setConnectionCallback(connectionCallback_);
   conn->setMessageCallback(messageCallback_);
   conn->setWriteCompleteCallback(writeCompleteCallback_);
+  conn->setEdgeTriggered(edgeTriggered_, edgeTriggeredBudget_);
+  conn->setChainedOutput(chainedOutput_);
+  if (zeroCopyThreshold_ > 0) {
+    conn->setZeroCopy(zeroCopyThreshold_);
+  }
+  conn->setAutoCork(autoCork_);
+  if (backpressureHighWaterMark_ > 0) {
+    conn->setBackpressure(conn, backpressureHighWaterMark_,
+                          backpressureLowWaterMark_);
+  }
+  return conn;
+}
+
+void TcpServer::removeConnection(LoopShard *shard,
+                                 const TcpConnectionPtr &conn) {
+  shard->loop->assertInLoopThread();
+  LOG_INFO << "TcpServer::removeConnection [" << name_ << "] - connection "
+           << conn->name();
+  // erase不能写在assert里，Release(NDEBUG)下会被整个去掉，连接永远不会析构
+  size_t n = shard->connections.erase(conn->id());
+  (void)n;
+  assert(n == 1);
+  shard->numConnections.fetch_sub(1, std::memory_order_relaxed);
+  // 正在处理该连接channel的事件，channel要等到事件处理完才能移除
+  shard->loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+}
 
-  // 设置了如何关闭连接的回调
-  conn->setCloseCallback(
-      std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));
+TcpServer::LoopShard *TcpServer::shardOf(EventLoop *loop) {
+  for (auto &shard : shards_) {
+    if (shard->loop == loop) {
+      return shard.get();
+    }
+  }
+  LOG_FATAL << "TcpServer::shardOf [" << name_ << "] - unknown loop " << loop;
+  return nullptr;
+}
 
-  ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+int TcpServer::numConnections() const {
+  int n = 0;
+  for (auto &shard : shards_) {
+    n += shard->numConnections.load(std::memory_order_relaxed);
+  }
+  return n;
 }
 
-void TcpServer::removeConnection(const TcpConnectionPtr &conn) {
-  loop_->runInLoop(std::bind(&TcpServer::removeConnectionInLoop, this, conn));
+void TcpServer::forEachConnection(const ConnectionVisitor &visitor) {
+  for (auto &shard : shards_) {
+    LoopShard *s = shard.get();
+    s->loop->runInLoop([s, visitor] {
+      // visitor可能关闭连接而修改connections，先复制一份
+      std::vector<TcpConnectionPtr> conns;
+      conns.reserve(s->connections.size());
+      for (auto &item : s->connections) {
+        conns.push_back(item.second);
+      }
+      for (const TcpConnectionPtr &conn : conns) {
+        visitor(conn);
+      }
+    });
+  }
 }
 
-void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn) {
-  loop_->assertInLoopThread();
-  LOG_INFO << "TcpServer::removeConnectionInLoop [" << name_
-           << "] - connection " << conn->name();
-  assert(connections_.erase(conn->name()) == 1);
-  EventLoop *ioLoop = conn->getLoop();
-  ioLoop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+void TcpServer::destroyShard(LoopShard *shard) {
+  // Acceptor和连接的channel只能在所属loop中移除，等它完成后才能析构TcpServer
+  std::promise<void> done;
+  shard->loop->runInLoop([shard, &done] {
+    shard->acceptor.reset();
+    for (auto &item : shard->connections) {
+      item.second->connectDestroyed();
+    }
+    shard->connections.clear();
+    shard->numConnections = 0;
+    done.set_value();
+  });
+  done.get_future().wait();
 }
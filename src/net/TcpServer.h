@@ -13,15 +13,20 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace mymuduo {
 
 class TcpServer : noncopyable {
 public:
   using ThreadInitCallback = std::function<void(EventLoop *)>;
+  using ConnectionVisitor = std::function<void(const TcpConnectionPtr &)>;
   enum Option {
     kNoReusePort,
     kReusePort,
+    // 每个subLoop各自以SO_REUSEPORT监听同一地址，由内核分配新连接，
+    // 在本loop中accept并建立连接，不经过baseLoop；没有subLoop时同kReusePort
+    kReusePortPerLoop,
   };
 
   // TcpServer(EventLoop *loop, InetAddress &listenAddr,
@@ -48,6 +53,61 @@ public:
   // 设置底层subLoop的个数
   void setThreadNum(int numThreads);
 
+  // subLoop开启自适应busy poll，用CPU换取更低的延迟，见EventLoop::setBusyPoll
+  void setBusyPoll(int maxSpinUs) { threadPool_->setBusyPoll(maxSpinUs); }
+
+  // 线程池，start()之后可以通过它取得各个loop及其统计
+  std::shared_ptr<EventLoopThreadPool> threadPool() { return threadPool_; }
+
+  // subLoop的定时器使用时间轮，连接数很多且每个连接都有超时定时器时使用
+  void setTimingWheel(bool on) { threadPool_->setTimingWheel(on); }
+
+  // 第i个subLoop绑定到cpuSets[i % cpuSets.size()]中的CPU上
+  void setCpuAffinity(std::vector<std::vector<int>> cpuSets) {
+    threadPool_->setCpuAffinity(std::move(cpuSets));
+  }
+  // subLoop的线程和内存放在NUMA节点node上
+  void setNumaNode(int node) { threadPool_->setNumaNode(node); }
+  // subLoop放在网卡ifname所在的NUMA节点上，节点未知时不做限制
+  void setNumaNodeOfInterface(const std::string &ifname);
+
+  // 新连接以EPOLLET注册，读写直到EAGAIN，每次唤醒最多处理budget字节
+  void setEdgeTriggered(bool on, size_t budget =
+                                     TcpConnection::kDefaultEdgeTriggeredBudget) {
+    edgeTriggered_ = on;
+    edgeTriggeredBudget_ = budget;
+  }
+
+  // 新连接的发送缓冲区使用BufferChain，见TcpConnection::setChainedOutput
+  void setChainedOutput(bool on) { chainedOutput_ = on; }
+
+  // 新连接自动合并一轮中的多次send，见TcpConnection::setAutoCork
+  void setAutoCork(bool on) { autoCork_ = on; }
+
+  // 新连接待发送的数据超过highWaterMark时暂停读该连接，降到lowWaterMark以下时恢复，
+  // 0表示关闭，见TcpConnection::setBackpressure
+  void setBackpressure(size_t highWaterMark, size_t lowWaterMark) {
+    backpressureHighWaterMark_ = highWaterMark;
+    backpressureLowWaterMark_ = lowWaterMark;
+  }
+
+  // 新连接以MSG_ZEROCOPY发送大块数据，0表示关闭，见TcpConnection::setZeroCopy
+  void setZeroCopy(size_t threshold = TcpConnection::kDefaultZeroCopyThreshold) {
+    zeroCopyThreshold_ = threshold;
+  }
+
+  // 为新连接选择subLoop的策略，默认轮询，见LoopSelector；
+  // kReusePortPerLoop时由内核分配连接，不使用该策略
+  void setLoopSelector(std::unique_ptr<LoopSelector> selector) {
+    threadPool_->setLoopSelector(std::move(selector));
+  }
+
+  // 每次可读通知最多accept的连接数，见Acceptor::setBatchSize，需要在start之前设置
+  void setAcceptBatchSize(int batchSize) {
+    acceptBatchSize_ = batchSize;
+    acceptor_->setBatchSize(batchSize);
+  }
+
   // 开启服务器监听
   void start();
 
@@ -57,17 +117,54 @@ public:
 
   const std::string ipPort() { return ipPort_; }
 
+  // 当前的连接数，可以在任意线程调用
+  int numConnections() const;
+
+  // 对每个连接调用visitor，在连接所属的loop线程中异步执行，可用于关闭所有连接或收集统计
+  void forEachConnection(const ConnectionVisitor &visitor);
+
 private:
+  using ConnectionMap = std::unordered_map<uint64_t, TcpConnectionPtr>;
+  // 一个loop的连接表，连接的建立和移除都在该loop中完成，不经过baseLoop
+  struct LoopShard {
+    EventLoop *loop;
+    std::unique_ptr<Acceptor> acceptor; // 只在kReusePortPerLoop时使用
+    ConnectionMap connections;          // 只在loop线程访问
+    std::atomic_int numConnections;     // connections.size()，供其他线程读取
+    // 本批accept的、分给该loop的连接，等待dispatchConnections，只在baseLoop访问
+    std::vector<TcpConnectionPtr> pendingConnections;
+  };
+
   void newConnection(int sockfd, const InetAddress &peerAddr);
-  void removeConnection(const TcpConnectionPtr &conn);
-  void removeConnectionInLoop(const TcpConnectionPtr &conn);
+  // Acceptor一批连接accept完后，每个subLoop一次queueInLoop建立它的连接
+  void dispatchConnections();
+  // kReusePortPerLoop模式下在subLoop中accept到新连接
+  void newConnectionInLoop(LoopShard *shard, int sockfd,
+                           const InetAddress &peerAddr);
+  // 在shard的loop中登记并建立连接
+  void establishConnection(LoopShard *shard, const TcpConnectionPtr &conn);
+  // 连接关闭时在它所属的loop中调用
+  void removeConnection(LoopShard *shard, const TcpConnectionPtr &conn);
+  // 创建连接并应用TcpServer上的回调和选项，不包括closeCallback
+  TcpConnectionPtr createConnection(EventLoop *ioLoop, int sockfd,
+                                    const InetAddress &peerAddr);
+  // subLoop不多，线性查找
+  LoopShard *shardOf(EventLoop *loop);
+  // 在loop线程中关闭监听socket并销毁它的连接，等待完成后返回
+  void destroyShard(LoopShard *shard);
 
 private:
-  using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
   EventLoop *loop_;                    // 用户定义的baseLoop
   const std::string ipPort_;           // 传入的IP地址和端口号
   const std::string name_;             // TcpServer名字
+  // 连接名字的前缀"name-ip:port"，所有连接共用
+  const std::shared_ptr<const std::string> connNamePrefix_;
+  const InetAddress listenAddr_;
+  const Option option_;
   std::unique_ptr<Acceptor> acceptor_; // Acceptor对象负责监视
+  // 每个loop一个连接表，start()时创建，之后不再改变
+  std::vector<std::unique_ptr<LoopShard>> shards_;
+  int acceptBatchSize_;
 
   std::shared_ptr<EventLoopThreadPool> threadPool_; // 线程池
 
@@ -77,8 +174,14 @@ private:
   // TODO: CloseCallback closeCallback_;
   ThreadInitCallback threadInitCallback_; // loop线程初始化的回调函数
   std::atomic_int started_;
-  int nextConnId_;            // 连接索引
-  ConnectionMap connections_; // 保存所有的连接
+  std::atomic<uint64_t> nextConnId_; // 连接索引，kReusePortPerLoop时各个subLoop共用
+  bool edgeTriggered_;        // 新连接是否使用ET模式
+  size_t edgeTriggeredBudget_;
+  bool chainedOutput_;        // 新连接的发送缓冲区是否使用BufferChain
+  size_t zeroCopyThreshold_;  // 新连接的MSG_ZEROCOPY阈值，0表示不使用
+  bool autoCork_;             // 新连接是否自动合并发送
+  size_t backpressureHighWaterMark_; // 新连接暂停读的高水位，0表示不限制
+  size_t backpressureLowWaterMark_;
 };
 
 } // namespace mymuduo
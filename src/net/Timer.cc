@@ -2,8 +2,6 @@
 
 using namespace mymuduo;
 
-std::atomic<int64_t> Timer::s_numCreated_;
-
 void Timer::restart(Timestamp now) {
   if (repeat_) {
     // 如果是重复定时事件，则继续添加定时事件，得到新事件到期事件
@@ -11,4 +9,4 @@ void Timer::restart(Timestamp now) {
   } else {
     expiration_ = Timestamp::invalid();
   }
-}
\ No newline at end of file
+}
@@ -5,37 +5,38 @@
 #include "src/base/noncopyable.h"
 #include "src/net/Callbacks.h"
 
-#include <atomic>
 #include <functional>
 
 namespace mymuduo {
 
+// 定时器对象放在TimerPool的槽中反复使用，由reset/clear设置和清空
 class Timer : noncopyable {
 public:
-  Timer(TimerCallback cb, Timestamp when, double interval)
-      : callback_(std::move(cb)), expiration_(when), interval_(interval),
-        repeat_(interval > 0.0), sequence_(++s_numCreated_) {}
+  Timer() : interval_(0.0), repeat_(false) {}
+
+  void reset(TimerCallback cb, Timestamp when, double interval) {
+    callback_ = std::move(cb);
+    expiration_ = when;
+    interval_ = interval;
+    repeat_ = interval > 0.0;
+  }
+  // 释放回调持有的资源(如TcpConnectionPtr)
+  void clear() { callback_ = nullptr; }
 
   void run() const { callback_(); }
 
   Timestamp expiration() const { return expiration_; }
   bool repeat() const { return repeat_; }
-  int64_t sequence() const { return sequence_; }
 
   void restart(Timestamp now);
 
-  static int64_t numCreated() { return s_numCreated_.load(); }
-
 private:
-  const TimerCallback callback_; // 定时器回调函数
-  Timestamp expiration_;         // 下一次的超时时刻
-  const double interval_; // 超时时间间隔，如果是一次性定时器，该值为0
-  const bool repeat_;      // 是否重复(false 表示是一次性定时器)
-  const int64_t sequence_; // 定时器序号
-
-  static std::atomic<int64_t> s_numCreated_;
+  TimerCallback callback_; // 定时器回调函数
+  Timestamp expiration_;   // 下一次的超时时刻
+  double interval_; // 超时时间间隔，如果是一次性定时器，该值为0
+  bool repeat_;     // 是否重复(false 表示是一次性定时器)
 };
 
 } // namespace mymuduo
 
-#endif // MYMUDUO_NET_TIMER_H
\ No newline at end of file
+#endif // MYMUDUO_NET_TIMER_H
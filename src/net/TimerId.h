@@ -1,23 +1,27 @@
 #ifndef MYMUDUO_NET_TIMERID_H
 #define MYMUDUO_NET_TIMERID_H
 
-#include "src/base/Timestamp.h"
-#include <atomic>
+#include <stdint.h>
 
 namespace mymuduo {
-class Timer;
+template <typename T> class TimerPool;
 
+/**
+ * 定时器在所属loop的TimerPool中的槽下标和代数
+ * 槽被回收时代数加一，旧的TimerId随之失效，重复cancel或cancel已触发的定时器都是安全的
+ */
 class TimerId {
 public:
-  friend class TimerQueue;
-  TimerId() : timer_(nullptr), sequence_(0) {}
-
-  TimerId(Timer *timer, int64_t seq) : timer_(timer), sequence_(seq) {}
+  template <typename T> friend class TimerPool;
+  TimerId() : index_(0), generation_(0) {}
 
 private:
-  Timer *timer_;
-  int64_t sequence_;
+  TimerId(uint32_t index, uint32_t generation)
+      : index_(index), generation_(generation) {}
+
+  uint32_t index_;
+  uint32_t generation_; // 有效的代数从1开始
 };
 } // namespace mymuduo
 
-#endif // MYMUDUO_NET_TIMERID_H
\ No newline at end of file
+#endif // MYMUDUO_NET_TIMERID_H
@@ -0,0 +1,122 @@
+#ifndef MYMUDUO_NET_TIMERPOOL_H
+#define MYMUDUO_NET_TIMERPOOL_H
+
+#include "src/base/noncopyable.h"
+#include "src/logger/Logging.h"
+#include "src/net/TimerId.h"
+
+#include <atomic>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace mymuduo {
+
+/**
+ * 每个TimerQueue一个的定时器对象池，T为定时器队列自己的节点类型
+ * 槽按块分配，块一旦分配就不再移动，也不归还给系统；空闲的槽串成链表反复使用。
+ * 稳定运行后添加/取消定时器不再有堆分配，TimerId只是槽下标加代数，
+ * cancel时比较代数即可判断定时器是否还有效。
+ * allocate可以在任意线程调用(空闲链表由mutex保护)，其余函数只在loop线程调用。
+ */
+template <typename T> class TimerPool : noncopyable {
+public:
+  TimerPool() : freeHead_(kNil), numSlots_(0), numLive_(0) {
+    for (std::atomic<Slot *> &chunk : chunks_) {
+      chunk.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  ~TimerPool() {
+    for (std::atomic<Slot *> &chunk : chunks_) {
+      delete[] chunk.load(std::memory_order_relaxed);
+    }
+  }
+
+  // 分配一个槽，返回槽下标，*id为对应的TimerId
+  uint32_t allocate(TimerId *id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t index = freeHead_;
+    if (index != kNil) {
+      freeHead_ = slot(index).nextFree;
+    } else {
+      index = numSlots_++;
+      std::atomic<Slot *> &chunk = chunks_[index >> kChunkBits];
+      if ((index & kChunkMask) == 0) {
+        if (index >> kChunkBits >= kMaxChunks) {
+          LOG_FATAL << "TimerPool::allocate() too many timers";
+        }
+        chunk.store(new Slot[kChunkSize], std::memory_order_release);
+      }
+    }
+    ++numLive_;
+    *id = TimerId(index, slot(index).generation);
+    return index;
+  }
+
+  // 回收槽，之前发出的TimerId全部失效
+  void release(uint32_t index) {
+    Slot &s = slot(index);
+    // 代数跳过0，默认构造的TimerId永远无效
+    if (++s.generation == 0) {
+      s.generation = 1;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    s.nextFree = freeHead_;
+    freeHead_ = index;
+    --numLive_;
+  }
+
+  T &at(uint32_t index) { return slot(index).value; }
+
+  // id仍然有效时返回它的槽下标，否则返回kNil
+  uint32_t find(TimerId id) const {
+    if (id.generation_ == 0 || id.index_ >= kMaxChunks * kChunkSize) {
+      return kNil;
+    }
+    const Slot *chunk =
+        chunks_[id.index_ >> kChunkBits].load(std::memory_order_acquire);
+    if (chunk == nullptr ||
+        chunk[id.index_ & kChunkMask].generation != id.generation_) {
+      return kNil;
+    }
+    return id.index_;
+  }
+
+  // 未回收的槽数
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return numLive_;
+  }
+
+  static const uint32_t kNil = ~0U;
+
+private:
+  struct Slot {
+    Slot() : generation(1), nextFree(kNil) {}
+    T value;
+    uint32_t generation;
+    uint32_t nextFree;
+  };
+
+  // 每块4096个槽，最多4096块，每个loop最多约1600万个定时器
+  static const uint32_t kChunkBits = 12;
+  static const uint32_t kChunkSize = 1U << kChunkBits;
+  static const uint32_t kChunkMask = kChunkSize - 1;
+  static const uint32_t kMaxChunks = 4096;
+
+  Slot &slot(uint32_t index) {
+    return chunks_[index >> kChunkBits].load(
+        std::memory_order_acquire)[index & kChunkMask];
+  }
+
+  mutable std::mutex mutex_;
+  uint32_t freeHead_;
+  uint32_t numSlots_;
+  size_t numLive_;
+  std::atomic<Slot *> chunks_[kMaxChunks];
+};
+
+} // namespace mymuduo
+
+#endif // MYMUDUO_NET_TIMERPOOL_H
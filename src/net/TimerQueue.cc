@@ -1,9 +1,9 @@
 #include "src/net/TimerQueue.h"
 #include "src/logger/Logging.h"
-#include "src/net/EventLoop.h"
-#include "src/net/Timer.h"
-#include "src/net/TimerId.h"
+#include "src/net/SortedTimerQueue.h"
+#include "src/net/TimingWheel.h"
 
+#include <cstdlib>
 #include <sys/timerfd.h>
 #include <unistd.h>
 
@@ -53,9 +53,9 @@ void resetTimerfd(int timerfd, Timestamp expiration) {
   }
 }
 
-TimerQueue::TimerQueue(EventLoop *loop)
-    : loop_(loop), timerfd_(createTimerfd()), timerfdChannel_(loop, timerfd_),
-      timers_(), callingExpiredTimers_(false) {
+TimerQueue::TimerQueue(EventLoop *loop, Type type)
+    : loop_(loop), type_(type), timerfd_(createTimerfd()),
+      timerfdChannel_(loop, timerfd_) {
   timerfdChannel_.setReadCallback(std::bind(&TimerQueue::handleRead, this));
   // we are always reading the timerfd, we disarm it with timerfd_settime.
   timerfdChannel_.enableReading();
@@ -65,102 +65,28 @@ TimerQueue::~TimerQueue() {
   timerfdChannel_.disableAll();
   timerfdChannel_.remove();
   ::close(timerfd_);
-  // do not remove channel, since we're in EventLoop::dtor();
-  for (const Entry &timer : timers_) {
-    delete timer.second;
-  }
-}
-
-TimerId TimerQueue::addTimer(TimerCallback cb, Timestamp when,
-                             double interval) {
-  Timer *timer = new Timer(std::move(cb), when, interval);
-  loop_->runInLoop(std::bind(&TimerQueue::addTimerInLoop, this, timer));
-  return TimerId(timer, timer->sequence());
 }
 
-void TimerQueue::cancel(TimerId timerId) {
-  loop_->runInLoop(std::bind(&TimerQueue::cancelInLoop, this, timerId));
+TimerQueue *TimerQueue::newTimerQueue(EventLoop *loop, Type type) {
+  if (type == kTimingWheel) {
+    return new TimingWheel(loop);
+  }
+  return new SortedTimerQueue(loop);
 }
 
-void TimerQueue::addTimerInLoop(Timer *timer) {
-  bool earliestChanged = insert(timer);
-  if (earliestChanged) {
-    resetTimerfd(timerfd_, timer->expiration());
+TimerQueue *TimerQueue::newDefaultTimerQueue(EventLoop *loop) {
+  if (::getenv("MUDUO_USE_TIMING_WHEEL")) {
+    return new TimingWheel(loop);
   }
+  return new SortedTimerQueue(loop);
 }
 
-void TimerQueue::cancelInLoop(TimerId timerId) {
-  ActiveTimer timer(timerId.timer_, timerId.sequence_);
-  ActiveTimerSet::iterator it = activeTimers_.find(timer);
-  if (it != activeTimers_.end()) {
-    size_t n = timers_.erase(Entry(it->first->expiration(), it->first));
-    delete it->first; // FIXME: no delete please
-    activeTimers_.erase(it);
-  } else if (callingExpiredTimers_) {
-    cancelingTimers_.insert(timer);
-  }
+void TimerQueue::resetTimerfd(Timestamp expiration) {
+  ::resetTimerfd(timerfd_, expiration);
 }
 
 void TimerQueue::handleRead() {
   Timestamp now(Timestamp::now());
   readTimerfd(timerfd_, now);
-
-  std::vector<Entry> expired = getExpired(now);
-
-  callingExpiredTimers_.store(true);
-  cancelingTimers_.clear();
-  // safe to callback outside critical section
-  for (const Entry &it : expired) {
-    it.second->run();
-  }
-  callingExpiredTimers_.store(false);
-
-  reset(expired, now);
-}
-
-std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timestamp now) {
-  std::vector<Entry> expired;
-  Entry sentry(now, reinterpret_cast<Timer *>(UINTPTR_MAX));
-  TimerList::iterator end = timers_.lower_bound(sentry);
-  std::copy(timers_.begin(), end, back_inserter(expired));
-  timers_.erase(timers_.begin(), end);
-  for (const Entry &it : expired) {
-    ActiveTimer timer(it.second, it.second->sequence());
-    size_t n = activeTimers_.erase(timer);
-  }
-  return expired;
-}
-
-void TimerQueue::reset(const std::vector<Entry> &expired, Timestamp now) {
-  Timestamp nextExpire;
-
-  for (const Entry &it : expired) {
-    ActiveTimer timer(it.second, it.second->sequence());
-    if (it.second->repeat() &&
-        cancelingTimers_.find(timer) == cancelingTimers_.end()) {
-      it.second->restart(now);
-      insert(it.second);
-    } else {
-      delete it.second;
-    }
-  }
-
-  if (!timers_.empty()) {
-    nextExpire = (timers_.begin()->second)->expiration();
-  }
-
-  if (nextExpire.valid()) {
-    resetTimerfd(timerfd_, nextExpire);
-  }
-}
-
-bool TimerQueue::insert(Timer *timer) {
-  bool earliestChanged = false;
-  Timestamp when = timer->expiration();
-  TimerList::iterator it = timers_.begin();
-  if (it == timers_.end() || when < it->first) {
-    earliestChanged = true;
-  }
-  timers_.insert(Entry(when, timer));
-  return earliestChanged;
+  handleExpired(now);
 }
@@ -1,11 +1,6 @@
 #ifndef MYMUDUO_NET_TIMERQUEUE_H
 #define MYMUDUO_NET_TIMERQUEUE_H
 
-#include <mutex>
-#include <set>
-#include <vector>
-#include <atomic>
-
 #include "src/base/Timestamp.h"
 #include "src/base/noncopyable.h"
 #include "src/net/Callbacks.h"
@@ -13,49 +8,57 @@
 
 namespace mymuduo {
 class EventLoop;
-class Timer;
 class TimerId;
 
+/**
+ * 定时器队列的抽象基类，负责timerfd的创建、读取和设置
+ * 子类决定定时器的组织方式：
+ *   SortedTimerQueue: 按到期时间排序的std::set，精确到微秒，添加O(log n)，
+ *                     取消只标记槽位O(1)，到期或清理时才从set中移除
+ *   TimingWheel     : 分层时间轮，精度为1毫秒，增删O(1)，适合大量定时器
+ */
 class TimerQueue : noncopyable {
 public:
-  explicit TimerQueue(EventLoop *loop);
-  ~TimerQueue();
+  enum Type {
+    kSorted,
+    kTimingWheel,
+  };
 
-  TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
-  void cancel(TimerId timerId);
+  TimerQueue(EventLoop *loop, Type type);
+  virtual ~TimerQueue();
 
-private:
-  using Entry = std::pair<Timestamp, Timer *>;
-  using TimerList = std::set<Entry>;
-  using ActiveTimer = std::pair<Timer *, int64_t>;
-  using ActiveTimerSet = std::set<ActiveTimer>;
+  // 线程安全，可以在任意线程调用
+  virtual TimerId addTimer(TimerCallback cb, Timestamp when,
+                           double interval) = 0;
+  virtual void cancel(TimerId timerId) = 0;
 
-  // called when timerfd alarms
-  void handleRead();
+  // 尚未到期的定时器数量，只能在loop线程调用
+  virtual size_t size() const = 0;
 
-  void addTimerInLoop(Timer *timer);
-  void cancelInLoop(TimerId timerId);
+  Type type() const { return type_; }
 
-  // move out all expired timers
-  std::vector<Entry> getExpired(Timestamp now);
+  static TimerQueue *newTimerQueue(EventLoop *loop, Type type);
+  // 设置了环境变量MUDUO_USE_TIMING_WHEEL时使用时间轮
+  static TimerQueue *newDefaultTimerQueue(EventLoop *loop);
 
-  void reset(const std::vector<Entry> &expired, Timestamp now);
+protected:
+  // timerfd可读时调用，处理now及之前到期的定时器
+  virtual void handleExpired(Timestamp now) = 0;
 
-  bool insert(Timer *timer);
+  // 让timerfd在expiration时刻可读
+  void resetTimerfd(Timestamp expiration);
 
-private:
   EventLoop *loop_;
+
+private:
+  // called when timerfd alarms
+  void handleRead();
+
+  const Type type_;
   const int timerfd_;
   Channel timerfdChannel_;
-  // Timer list sorted by expiration
-  TimerList timers_;
-
-  // for cancel()
-  ActiveTimerSet activeTimers_;
-  std::atomic_bool callingExpiredTimers_;
-  ActiveTimerSet cancelingTimers_;
 };
 
 } // namespace mymuduo
 
-#endif // MYMUDUO_NET_TIMERQUEUE_H
\ No newline at end of file
+#endif // MYMUDUO_NET_TIMERQUEUE_H
@@ -0,0 +1,242 @@
+#include "src/net/TimingWheel.h"
+#include "src/logger/Logging.h"
+#include "src/net/EventLoop.h"
+#include "src/net/TimerId.h"
+
+#include <algorithm>
+#include <string.h>
+
+using namespace mymuduo;
+
+namespace {
+// 在numWords个字组成的位图中，从第start位开始循环查找第一个置位的位，
+// 返回它与start的距离，没有置位的位时返回-1
+int distanceToNextBit(const uint64_t *words, int numWords, int start) {
+  const int numBits = numWords * 64;
+  int word = start / 64;
+  uint64_t bits = words[word] & (~0ULL << (start % 64));
+  // 最后一次回到起始的字，检查start之前的位
+  for (int i = 0; i <= numWords; ++i) {
+    if (bits != 0) {
+      int bit = word * 64 + __builtin_ctzll(bits);
+      return (bit - start + numBits) % numBits;
+    }
+    word = (word + 1) % numWords;
+    bits = words[word];
+  }
+  return -1;
+}
+} // namespace
+
+TimingWheel::TimingWheel(EventLoop *loop)
+    : TimerQueue(loop, kTimingWheel),
+      currentTick_(toTick(Timestamp::now())), armedTick_(-1) {
+  memset(slots_, 0, sizeof slots_);
+  memset(bitmap_, 0, sizeof bitmap_);
+}
+
+TimingWheel::~TimingWheel() = default;
+
+TimerId TimingWheel::addTimer(TimerCallback cb, Timestamp when,
+                              double interval) {
+  TimerId timerId;
+  uint32_t index = pool_.allocate(&timerId);
+  Node *node = &pool_.at(index);
+  node->timer.reset(std::move(cb), when, interval);
+  node->index = index;
+  node->slot = kPending;
+  node->canceled = false;
+  if (loop_->isInLoopThread()) {
+    addTimerInLoop(node);
+  } else {
+    loop_->queueInLoop([this, node] { addTimerInLoop(node); });
+  }
+  return timerId;
+}
+
+void TimingWheel::cancel(TimerId timerId) {
+  if (loop_->isInLoopThread()) {
+    cancelInLoop(timerId);
+  } else {
+    loop_->queueInLoop([this, timerId] { cancelInLoop(timerId); });
+  }
+}
+
+void TimingWheel::addTimerInLoop(Node *node) {
+  if (node->canceled) {
+    release(node);
+    return;
+  }
+  node->tick = toTick(node->timer.expiration());
+  insert(node);
+  // 定时器所在的槽之前可能还有一次下放，但在它到期时一并处理即可
+  const int64_t tick = std::max(node->tick, currentTick_);
+  if (armedTick_ < 0 || tick < armedTick_) {
+    resetTimerfd(Timestamp(tick * 1000));
+    armedTick_ = tick;
+  }
+}
+
+void TimingWheel::cancelInLoop(TimerId timerId) {
+  uint32_t index = pool_.find(timerId);
+  if (index == TimerPool<Node>::kNil) {
+    // 已经触发或取消过
+    return;
+  }
+  Node *node = &pool_.at(index);
+  if (node->slot < 0) {
+    // 由addTimerInLoop/handleExpired负责回收
+    node->canceled = true;
+    return;
+  }
+  unlink(node);
+  release(node);
+}
+
+void TimingWheel::release(Node *node) {
+  node->timer.clear();
+  pool_.release(node->index);
+}
+
+void TimingWheel::handleExpired(Timestamp now) {
+  // timerfd是一次性的，已经触发
+  armedTick_ = -1;
+  const int64_t nowTick = now.microSecondsSinceEpoch() / 1000;
+
+  // 跳过空的tick，只在有定时器到期或需要下放的tick上停下
+  int64_t tick;
+  while ((tick = nextEventTick()) >= 0 && tick <= nowTick) {
+    currentTick_ = tick;
+    for (int level = 1; level < kLevels; ++level) {
+      if ((tick & ((1LL << shiftOf(level)) - 1)) != 0) {
+        break;
+      }
+      cascade(level, static_cast<int>((tick >> shiftOf(level)) &
+                                      (kLevelSlots - 1)));
+    }
+
+    const int slot = static_cast<int>(tick & (kRootSlots - 1));
+    Node *node = slots_[slot];
+    slots_[slot] = nullptr;
+    bitmap_[slot / 64] &= ~(1ULL << (slot % 64));
+    currentTick_ = tick + 1;
+    while (node != nullptr) {
+      Node *next = node->next;
+      node->prev = node->next = nullptr;
+      node->slot = kRunning;
+      if (node->tick > tick) {
+        // 超出时间轮范围的定时器，重新放置
+        insert(node);
+      } else {
+        expired_.push_back(node);
+      }
+      node = next;
+    }
+  }
+
+  // 回调中可能添加/取消定时器
+  for (Node *node : expired_) {
+    node->timer.run();
+  }
+
+  for (Node *node : expired_) {
+    if (node->timer.repeat() && !node->canceled) {
+      node->timer.restart(now);
+      node->tick = toTick(node->timer.expiration());
+      insert(node);
+    } else {
+      release(node);
+    }
+  }
+  expired_.clear();
+
+  rearm();
+}
+
+void TimingWheel::insert(Node *node) {
+  const int64_t tick = std::max(node->tick, currentTick_);
+  const int64_t delta = std::min(tick - currentTick_, kMaxTicks - 1);
+  // 放置位置，超出范围时先放在最远处
+  const int64_t where = currentTick_ + delta;
+  int slot;
+  if (delta < kRootSlots) {
+    slot = static_cast<int>(where & (kRootSlots - 1));
+  } else {
+    int level = 1;
+    while (delta >= (1LL << shiftOf(level + 1))) {
+      ++level;
+    }
+    slot = baseOf(level) +
+           static_cast<int>((where >> shiftOf(level)) & (kLevelSlots - 1));
+  }
+
+  node->slot = slot;
+  node->prev = nullptr;
+  node->next = slots_[slot];
+  if (node->next != nullptr) {
+    node->next->prev = node;
+  }
+  slots_[slot] = node;
+  bitmap_[slot / 64] |= 1ULL << (slot % 64);
+}
+
+void TimingWheel::unlink(Node *node) {
+  const int slot = node->slot;
+  if (node->prev != nullptr) {
+    node->prev->next = node->next;
+  } else {
+    slots_[slot] = node->next;
+  }
+  if (node->next != nullptr) {
+    node->next->prev = node->prev;
+  }
+  if (slots_[slot] == nullptr) {
+    bitmap_[slot / 64] &= ~(1ULL << (slot % 64));
+  }
+  node->prev = node->next = nullptr;
+}
+
+void TimingWheel::cascade(int level, int index) {
+  const int slot = baseOf(level) + index;
+  Node *node = slots_[slot];
+  slots_[slot] = nullptr;
+  bitmap_[slot / 64] &= ~(1ULL << (slot % 64));
+  while (node != nullptr) {
+    Node *next = node->next;
+    insert(node);
+    node = next;
+  }
+}
+
+int64_t TimingWheel::nextEventTick() const {
+  int64_t next = -1;
+  // 第0层的槽与接下来的256个tick一一对应
+  int distance = distanceToNextBit(bitmap_, kRootSlots / 64,
+                                   static_cast<int>(currentTick_ &
+                                                    (kRootSlots - 1)));
+  if (distance >= 0) {
+    next = currentTick_ + distance;
+  }
+  // 第level层的槽只在低位全为0的tick下放，从不早于currentTick_的第一个这样的tick找起
+  for (int level = 1; level < kLevels; ++level) {
+    const int shift = shiftOf(level);
+    const int64_t block = (currentTick_ + (1LL << shift) - 1) >> shift;
+    distance = distanceToNextBit(&bitmap_[baseOf(level) / 64], 1,
+                                 static_cast<int>(block & (kLevelSlots - 1)));
+    if (distance >= 0) {
+      const int64_t tick = (block + distance) << shift;
+      if (next < 0 || tick < next) {
+        next = tick;
+      }
+    }
+  }
+  return next;
+}
+
+void TimingWheel::rearm() {
+  const int64_t tick = nextEventTick();
+  if (tick >= 0) {
+    resetTimerfd(Timestamp(tick * 1000));
+    armedTick_ = tick;
+  }
+}
@@ -0,0 +1,94 @@
+#ifndef MYMUDUO_NET_TIMINGWHEEL_H
+#define MYMUDUO_NET_TIMINGWHEEL_H
+
+#include "src/net/Timer.h"
+#include "src/net/TimerPool.h"
+#include "src/net/TimerQueue.h"
+
+#include <vector>
+
+namespace mymuduo {
+
+/**
+ * 分层时间轮，一个tick为1毫秒
+ * 第0层256个槽，每槽1个tick；第1~4层各64个槽，每层的一个槽覆盖下一层的一整圈，
+ * 总共覆盖2^32个tick(约49天)，更远的定时器先放在最远处，到时再重新放置。
+ * 定时器挂在槽的双向链表上，插入和取消都是O(1)；高层的槽在下一层转完一圈时
+ * 整体下放(cascade)。每层用位图记录非空的槽，timerfd只设置到下一个非空槽
+ * 或下一次需要下放的时刻，空闲的tick不会唤醒loop。
+ * 定时器在到期时刻之后的1毫秒内触发。
+ */
+class TimingWheel : public TimerQueue {
+public:
+  explicit TimingWheel(EventLoop *loop);
+  ~TimingWheel() override;
+
+  TimerId addTimer(TimerCallback cb, Timestamp when, double interval) override;
+  void cancel(TimerId timerId) override;
+  size_t size() const override { return pool_.size(); }
+
+private:
+  // 定时器与它在时间轮中的链表节点一起放在pool_的槽中
+  struct Node {
+    Node()
+        : tick(0), prev(nullptr), next(nullptr), index(0), slot(kPending),
+          canceled(false) {}
+
+    Timer timer;
+    int64_t tick; // 到期的tick
+    Node *prev;
+    Node *next;
+    uint32_t index; // 在pool_中的下标
+    int slot;       // 所在的槽，或者kPending/kRunning
+    bool canceled;  // 在kPending/kRunning状态下被取消
+  };
+  static const int kPending = -1; // 已分配，等待addTimerInLoop
+  static const int kRunning = -2; // 已到期，正在执行回调
+
+  static const int kLevels = 5;
+  static const int kRootBits = 8;
+  static const int kLevelBits = 6;
+  static const int kRootSlots = 1 << kRootBits;
+  static const int kLevelSlots = 1 << kLevelBits;
+  static const int kNumSlots = kRootSlots + (kLevels - 1) * kLevelSlots;
+  static const int64_t kMaxTicks = 1LL << (kRootBits + (kLevels - 1) * kLevelBits);
+
+  void handleExpired(Timestamp now) override;
+
+  void addTimerInLoop(Node *node);
+  void release(Node *node);
+  void cancelInLoop(TimerId timerId);
+
+  void insert(Node *node);
+  void unlink(Node *node);
+  // 把第level层的第index个槽中的定时器重新放置到更低的层
+  void cascade(int level, int index);
+  // 下一个需要处理的tick(到期或下放)，没有定时器时返回-1
+  int64_t nextEventTick() const;
+  void rearm();
+
+  static int64_t toTick(Timestamp when) {
+    // 向上取整，保证不会提前触发
+    return (when.microSecondsSinceEpoch() + 999) / 1000;
+  }
+  // 第level层槽下标对应的tick位移
+  static int shiftOf(int level) {
+    return level == 0 ? 0 : kRootBits + (level - 1) * kLevelBits;
+  }
+  // 第level层第一个槽在slots_中的下标
+  static int baseOf(int level) {
+    return level == 0 ? 0 : kRootSlots + (level - 1) * kLevelSlots;
+  }
+
+private:
+  int64_t currentTick_; // 下一个尚未处理的tick
+  int64_t armedTick_;   // timerfd设置的tick，-1表示没有设置
+  Node *slots_[kNumSlots];
+  uint64_t bitmap_[kNumSlots / 64]; // 非空的槽
+  TimerPool<Node> pool_;
+  std::vector<Node *> expired_;
+};
+
+} // namespace mymuduo
+
+#endif // MYMUDUO_NET_TIMINGWHEEL_H
@@ -0,0 +1,115 @@
+// 自动合并发送(TcpConnection::setAutoCork)对多次小块send的效果
+// 客户端一次发出pipeline个16字节的请求，读回全部响应后再发下一批；
+// 服务器对每个请求send三次(响应行、响应头、响应体)，比较每个请求的write/writev次数和吞吐
+// usage: net_autocork_bench [requests] [pipeline]
+#include "src/net/EventLoop.h"
+#include "src/net/TcpServer.h"
+#include "src/logger/Logging.h"
+#include "src/net/test/BenchUtil.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace mymuduo;
+
+static std::atomic<uint64_t> g_writes(0);
+
+// 统计服务器的write/writev次数，客户端用send/recv，不计入
+extern "C" ssize_t write(int fd, const void *buf, size_t count) {
+  g_writes.fetch_add(1, std::memory_order_relaxed);
+  return syscall(SYS_write, fd, buf, count);
+}
+
+extern "C" ssize_t writev(int fd, const struct iovec *iov, int iovcnt) {
+  g_writes.fetch_add(1, std::memory_order_relaxed);
+  return syscall(SYS_writev, fd, iov, iovcnt);
+}
+
+static const size_t kRequestSize = 16;
+static const char kStatusLine[] = "HTTP/1.1 200 OK\r\n";
+static const char kHeaders[] =
+    "Content-Type: text/plain\r\nContent-Length: 12\r\n\r\n";
+static const char kBody[] = "hello world\n";
+static const size_t kResponseSize =
+    sizeof kStatusLine - 1 + sizeof kHeaders - 1 + sizeof kBody - 1;
+
+static void onRequests(const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+  while (buf->readableBytes() >= kRequestSize) {
+    buf->retrieve(kRequestSize);
+    conn->send(kStatusLine, sizeof kStatusLine - 1);
+    conn->send(kHeaders, sizeof kHeaders - 1);
+    conn->send(kBody, sizeof kBody - 1);
+  }
+}
+
+static void runClient(uint16_t port, int requests, int pipeline,
+                      const char *name) {
+  int fd = connectTo(port);
+  const std::string batch(kRequestSize * pipeline, 'r');
+  std::vector<char> response(kResponseSize * pipeline);
+
+  const uint64_t writes = g_writes.load();
+  const int64_t start = nowNs();
+  for (int done = 0; done < requests; done += pipeline) {
+    if (::send(fd, batch.data(), batch.size(), 0) !=
+        static_cast<ssize_t>(batch.size())) {
+      perror("send");
+      exit(1);
+    }
+    size_t received = 0;
+    while (received < response.size()) {
+      ssize_t n = ::recv(fd, response.data() + received,
+                         response.size() - received, 0);
+      if (n <= 0) {
+        perror("recv");
+        exit(1);
+      }
+      received += n;
+    }
+  }
+  const int64_t elapsed = nowNs() - start;
+  printf("%-8s pipeline=%-3d %9.0f req/s  %5.3f writes/req\n", name, pipeline,
+         static_cast<double>(requests) * 1e9 / elapsed,
+         static_cast<double>(g_writes.load() - writes) / requests);
+  ::close(fd);
+}
+
+static void bench(bool autoCork, uint16_t port, int requests, int pipeline) {
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(port), "AutoCorkBench");
+  server.setConnectionCallback([](const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+      conn->setTcpNoDelay(true);
+    }
+  });
+  server.setMessageCallback(onRequests);
+  server.setAutoCork(autoCork);
+  server.start();
+
+  std::thread client([&] {
+    runClient(port, requests, pipeline, autoCork ? "autocork" : "plain");
+    loop.queueInLoop([&loop] { loop.quit(); });
+  });
+  loop.loop();
+  client.join();
+}
+
+int main(int argc, char *argv[]) {
+  int requests = argc > 1 ? atoi(argv[1]) : 200000;
+  int pipeline = argc > 2 ? atoi(argv[2]) : 16;
+  Logger::setLogLevel(Logger::WARN);
+
+  uint16_t port = 9981;
+  for (int depth : {1, pipeline}) {
+    bench(false, port++, requests, depth);
+    bench(true, port++, requests, depth);
+  }
+}
@@ -0,0 +1,109 @@
+// 慢速接收方下echo服务器发送缓冲区的峰值，比较是否开启TcpServer::setBackpressure
+// 客户端一个线程尽快写入total字节，另一个线程每读chunk字节休眠1ms；
+// 不限制时服务器把读到的数据全部堆在outputBuffer_中，开启后暂停读，数据留在内核缓冲区由TCP流控限速
+// ET模式下暂停读会让channel暂时没有关注的事件，检查之后能否恢复写，停顿5秒即判定失败
+// usage: net_backpressure_bench [totalMB] [highWaterMarkKB]
+#include "src/net/EventLoop.h"
+#include "src/net/TcpServer.h"
+#include "src/logger/Logging.h"
+#include "src/net/test/BenchUtil.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace mymuduo;
+
+static const size_t kChunk = 64 * 1024;
+
+static void runClient(uint16_t port, size_t total) {
+  int fd = connectTo(port);
+
+  // 服务器停止发送时recv超时返回，而不是一直阻塞
+  struct timeval timeout = {5, 0};
+  ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+
+  // 服务器读到EOF就关闭连接，所以写完后不shutdown，读完全部回显再close
+  std::thread writer([fd, total] {
+    std::vector<char> data(kChunk, 'x');
+    for (size_t sent = 0; sent < total;) {
+      ssize_t n = ::send(fd, data.data(), std::min(kChunk, total - sent), 0);
+      if (n <= 0) {
+        perror("send");
+        exit(1);
+      }
+      sent += n;
+    }
+  });
+
+  std::vector<char> data(kChunk);
+  for (size_t received = 0; received < total;) {
+    ssize_t n = ::recv(fd, data.data(), data.size(), 0);
+    if (n <= 0) {
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        fprintf(stderr, "stalled after receiving %zu of %zu bytes\n", received,
+                total);
+      } else {
+        perror("recv");
+      }
+      exit(1);
+    }
+    received += n;
+    ::usleep(1000);
+  }
+  writer.join();
+  ::close(fd);
+}
+
+static void bench(const char *name, uint16_t port, size_t total,
+                  size_t highWaterMark, bool edgeTriggered) {
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(port), "BackpressureBench");
+  size_t peakOutput = 0;
+  int pauses = 0;
+  server.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+    if (conn->connected() && highWaterMark > 0) {
+      conn->setHighWaterMarkCallback(
+          [&pauses](const TcpConnectionPtr &, size_t) { ++pauses; },
+          highWaterMark);
+    }
+  });
+  server.setMessageCallback(
+      [&peakOutput](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+        conn->send(buf);
+        peakOutput =
+            std::max(peakOutput, conn->outputBuffer()->readableBytes());
+      });
+  server.setEdgeTriggered(edgeTriggered);
+  if (highWaterMark > 0) {
+    server.setBackpressure(highWaterMark, highWaterMark / 4);
+  }
+  server.start();
+
+  const int64_t start = nowNs();
+  std::thread client([&] {
+    runClient(port, total);
+    loop.queueInLoop([&loop] { loop.quit(); });
+  });
+  loop.loop();
+  client.join();
+  const int64_t elapsed = nowNs() - start;
+  printf("%-16s %7.1f MB/s  peak output %8zu KB  %d pauses\n", name,
+         static_cast<double>(total) * 1000 / elapsed,
+         peakOutput / 1024, pauses);
+}
+
+int main(int argc, char *argv[]) {
+  size_t total = (argc > 1 ? atoi(argv[1]) : 64) * 1024 * 1024;
+  size_t highWaterMark = (argc > 2 ? atoi(argv[2]) : 1024) * 1024;
+  Logger::setLogLevel(Logger::WARN);
+
+  bench("unlimited", 9981, total, 0, false);
+  bench("backpressure", 9982, total, highWaterMark, false);
+  bench("backpressure+ET", 9983, total, highWaterMark, true);
+}
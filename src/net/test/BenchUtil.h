@@ -0,0 +1,50 @@
+#ifndef MYMUDUO_NET_TEST_BENCHUTIL_H
+#define MYMUDUO_NET_TEST_BENCHUTIL_H
+
+// 各个基准测试共用的计时和客户端连接函数
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+
+namespace mymuduo {
+
+inline int64_t nowNs() {
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+inline struct sockaddr_in loopbackAddr(uint16_t port) {
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  return addr;
+}
+
+// 阻塞地连接127.0.0.1:port，失败时退出
+// 关闭Nagle，客户端连续发出的小请求不会等对端的延迟确认
+inline int connectTo(uint16_t port) {
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = loopbackAddr(port);
+  if (::connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof addr) <
+      0) {
+    perror("connect");
+    exit(1);
+  }
+  int on = 1;
+  ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+  return fd;
+}
+
+} // namespace mymuduo
+
+#endif // MYMUDUO_NET_TEST_BENCHUTIL_H
@@ -0,0 +1,130 @@
+// Buffer中分隔符查找的吞吐
+//   lines  : 在大量流水线请求中逐行findCRLF并retrieve，即HttpConnection::parseRequest的模式，
+//            与原来基于std::search的findCRLF比较
+//   headers: 用find("\r\n\r\n")定位每个请求头的结尾，比较StringSearch的各个实现
+//   trickle: 请求每次到达chunk字节，每次到达后查找一行，比较从头扫描与可恢复的findCRLF
+// usage: net_buffer_search_bench [requests] [chunk]
+#include "src/base/StringSearch.h"
+#include "src/net/Buffer.h"
+#include "src/net/test/BenchUtil.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+using namespace mymuduo;
+
+// 浏览器发出的典型GET请求，约700字节
+static const char kRequest[] =
+    "GET /static/js/app.3f9a1c2e.js HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "Connection: keep-alive\r\n"
+    "sec-ch-ua: \"Chromium\";v=\"118\", \"Google Chrome\";v=\"118\"\r\n"
+    "sec-ch-ua-mobile: ?0\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, "
+    "like Gecko) Chrome/118.0.0.0 Safari/537.36\r\n"
+    "sec-ch-ua-platform: \"Linux\"\r\n"
+    "Accept: */*\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Sec-Fetch-Mode: no-cors\r\n"
+    "Sec-Fetch-Dest: script\r\n"
+    "Referer: https://www.example.com/index.html\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: en-US,en;q=0.9,zh-CN;q=0.8,zh;q=0.7\r\n"
+    "Cookie: session=6b1f0c3a9d2e4f5a8b7c6d5e4f3a2b1c; theme=dark; "
+    "_ga=GA1.2.1234567890.1697000000\r\n"
+    "\r\n";
+
+static const char *findCRLFStdSearch(const char *begin, const char *end) {
+  static const char kCRLF[] = "\r\n";
+  const char *crlf = std::search(begin, end, kCRLF, kCRLF + 2);
+  return crlf == end ? nullptr : crlf;
+}
+
+static void fill(Buffer *buf, int requests) {
+  for (int i = 0; i < requests; ++i) {
+    buf->append(kRequest, sizeof kRequest - 1);
+  }
+}
+
+static void report(const char *what, const char *impl, int64_t elapsed,
+                   int64_t ops, size_t bytes) {
+  printf("%-8s %-10s %8.1f ns/op  %6.2f GB/s\n", what, impl,
+         static_cast<double>(elapsed) / ops,
+         static_cast<double>(bytes) / elapsed);
+}
+
+static void benchLines(bool baseline, int requests) {
+  Buffer buf;
+  fill(&buf, requests);
+  const size_t bytes = buf.readableBytes();
+  int64_t lines = 0;
+  int64_t start = nowNs();
+  while (true) {
+    const char *crlf = baseline ? findCRLFStdSearch(buf.peek(), buf.beginWrite())
+                                : buf.findCRLF();
+    if (crlf == nullptr) {
+      break;
+    }
+    buf.retrieveUntil(crlf + 2);
+    ++lines;
+  }
+  report("lines", baseline ? "std::search" : "findCRLF", nowNs() - start, lines,
+         bytes);
+}
+
+static void benchHeaders(const char *impl, int requests) {
+  Buffer buf;
+  fill(&buf, requests);
+  const size_t bytes = buf.readableBytes();
+  int64_t start = nowNs();
+  const char *end;
+  while ((end = buf.find("\r\n\r\n", 4)) != nullptr) {
+    buf.retrieveUntil(end + 4);
+  }
+  report("headers", impl, nowNs() - start, requests, bytes);
+}
+
+// 第一行很长(如带查询参数的URL)，每到达chunk字节查找一次
+static void benchTrickle(bool resumable, int requests, size_t chunk) {
+  std::string request = "GET /search?q=" + std::string(8000, 'x') +
+                        " HTTP/1.1\r\n" + kRequest;
+  int64_t searches = 0;
+  int64_t start = nowNs();
+  for (int i = 0; i < requests / 10; ++i) {
+    Buffer buf;
+    for (size_t off = 0; off < request.size(); off += chunk) {
+      buf.append(request.data() + off, std::min(chunk, request.size() - off));
+      const char *crlf =
+          resumable ? buf.findCRLF() : buf.findCRLF(buf.peek());
+      ++searches;
+      if (crlf != nullptr) {
+        break;
+      }
+    }
+  }
+  report("trickle", resumable ? "resumable" : "from peek", nowNs() - start,
+         searches,
+         static_cast<size_t>(requests / 10) * 8000);
+}
+
+int main(int argc, char *argv[]) {
+  int requests = argc > 1 ? atoi(argv[1]) : 20000;
+  size_t chunk = argc > 2 ? atoi(argv[2]) : 64;
+  printf("requests: %d x %zu bytes, default implementation: %s\n", requests,
+         sizeof kRequest - 1, StringSearch::implementation());
+
+  benchLines(true, requests);
+  benchLines(false, requests);
+  benchTrickle(false, requests, chunk);
+  benchTrickle(true, requests, chunk);
+  const char *impls[] = {"scalar", "sse2", "avx2"};
+  for (const char *impl : impls) {
+    if (!StringSearch::setImplementation(impl)) {
+      printf("%s not supported\n", impl);
+      continue;
+    }
+    benchHeaders(impl, requests);
+  }
+}
@@ -0,0 +1,96 @@
+// 短连接的建立速率：每个连接建立后服务器发1字节并关闭(如HTTP/1.0)，客户端读到EOF后close，
+// TIME_WAIT留在服务器一侧，客户端的端口不会耗尽
+// 客户端threads个线程，每个线程先连续connect wave个连接再逐个读、关闭，backlog中会积压一批连接
+//   batch=1 : Acceptor每次可读通知只accept一个，每个连接各自唤醒subLoop一次
+//   batch=N : accept到EAGAIN(最多N个)，同一subLoop的连接合并为一次queueInLoop
+//   perloop : TcpServer::kReusePortPerLoop，每个subLoop各自accept
+// 统计每秒建立的连接数，以及每个连接的baseLoop和subLoop循环次数
+// usage: net_churn_bench [connections] [subLoops] [clientThreads] [wave]
+#include "src/net/EventLoop.h"
+#include "src/net/TcpServer.h"
+#include "src/logger/Logging.h"
+#include "src/net/test/BenchUtil.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace mymuduo;
+
+static void runClient(uint16_t port, int connections, int wave) {
+  std::vector<int> fds;
+  for (int done = 0; done < connections; done += wave) {
+    fds.clear();
+    for (int i = 0; i < wave && done + i < connections; ++i) {
+      fds.push_back(connectTo(port));
+    }
+    for (int fd : fds) {
+      char greeting[2];
+      if (::read(fd, greeting, sizeof greeting) != 1 ||
+          ::read(fd, greeting, sizeof greeting) != 0) {
+        perror("read");
+        exit(1);
+      }
+      ::close(fd);
+    }
+  }
+}
+
+static void bench(const char *name, uint16_t port, TcpServer::Option option,
+                  int batchSize, int connections, int subLoops,
+                  int clientThreads, int wave) {
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(port), "ChurnBench", option);
+  server.setThreadNum(subLoops);
+  server.setAcceptBatchSize(batchSize);
+  server.setConnectionCallback([](const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+      conn->send("x", 1);
+      conn->shutdown();
+    }
+  });
+  server.start();
+
+  const uint64_t baseIterations = loop.stats().iterations;
+  const uint64_t subIterations = server.threadPool()->stats().iterations;
+  const int64_t start = nowNs();
+  std::thread client([&] {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < clientThreads; ++i) {
+      threads.emplace_back(runClient, port, connections / clientThreads, wave);
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    loop.queueInLoop([&loop] { loop.quit(); });
+  });
+  loop.loop();
+  client.join();
+  const int64_t elapsed = nowNs() - start;
+  const double total = connections / clientThreads * clientThreads;
+  printf("%-9s %8.0f conn/s  base %5.2f iter/conn  sub %5.2f iter/conn\n",
+         name, total * 1e9 / elapsed,
+         (loop.stats().iterations - baseIterations) / total,
+         (server.threadPool()->stats().iterations - subIterations) / total);
+}
+
+int main(int argc, char *argv[]) {
+  int connections = argc > 1 ? atoi(argv[1]) : 50000;
+  int subLoops = argc > 2 ? atoi(argv[2]) : 2;
+  int clientThreads = argc > 3 ? atoi(argv[3]) : 4;
+  int wave = argc > 4 ? atoi(argv[4]) : 32;
+  Logger::setLogLevel(Logger::WARN);
+
+  printf("%d connections, %d subLoops, %d client threads x %d per wave\n",
+         connections, subLoops, clientThreads, wave);
+  bench("batch=1", 9981, TcpServer::kNoReusePort, 1, connections, subLoops,
+        clientThreads, wave);
+  bench("batch=64", 9982, TcpServer::kNoReusePort, 64, connections, subLoops,
+        clientThreads, wave);
+  bench("perloop", 9983, TcpServer::kReusePortPerLoop, 64, connections,
+        subLoops, clientThreads, wave);
+}
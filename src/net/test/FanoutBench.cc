@@ -0,0 +1,158 @@
+// 一条消息广播给多个连接：拷贝发送与共享消息(SharedPayload)发送的比较
+//   copy  : 每个连接send(data, len)，未发完的部分拷贝进各自的outputBuffer_
+//   shared: 消息只构造一次，每个连接send(payload)，未发完的部分以引用挂在outputChain_上
+// 客户端读完一轮才发下一轮。socket发送缓冲区有空间时两者都直接write；
+// 开启autocork时一轮的消息都先在服务器排队，本轮末尾每个连接一次writev，
+// 相当于发送缓冲区满时的情形。
+// 统计服务器广播一轮的耗时、每次投递的堆分配次数和字节数(包括客户端，客户端稳定后不分配)
+// usage: net_fanout_bench [connections] [rounds] [burst] [size]
+#include "src/net/EventLoop.h"
+#include "src/net/TcpServer.h"
+#include "src/logger/Logging.h"
+#include "src/net/test/BenchUtil.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace mymuduo;
+
+extern "C" void *__libc_malloc(size_t size);
+
+static std::atomic<uint64_t> g_allocations(0);
+static std::atomic<uint64_t> g_allocatedBytes(0);
+
+extern "C" void *malloc(size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+  return __libc_malloc(size);
+}
+
+struct Options {
+  int connections;
+  int rounds;
+  int burst;
+  size_t size;
+};
+
+static void bench(bool shared, bool autoCork, uint16_t port,
+                  const Options &opt) {
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(port), "FanoutBench");
+  std::vector<TcpConnectionPtr> subscribers;
+  std::atomic<int> numSubscribers(0);
+  const std::string message(opt.size, 'm');
+  int64_t broadcastNs = 0;
+
+  server.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+      // 否则每轮的多条小消息会被Nagle和延迟确认卡住，测到的是等待而不是发送开销
+      conn->setTcpNoDelay(true);
+      subscribers.push_back(conn);
+      ++numSubscribers;
+    }
+  });
+  // 任意一个连接收到请求时广播一轮
+  server.setMessageCallback([&](const TcpConnectionPtr &, Buffer *buf,
+                                Timestamp) {
+    buf->retrieveAll();
+    const int64_t start = nowNs();
+    for (int i = 0; i < opt.burst; ++i) {
+      if (shared) {
+        SharedPayload payload = std::make_shared<const std::string>(message);
+        for (const TcpConnectionPtr &conn : subscribers) {
+          conn->send(payload);
+        }
+      } else {
+        for (const TcpConnectionPtr &conn : subscribers) {
+          conn->send(message.data(), message.size());
+        }
+      }
+    }
+    broadcastNs += nowNs() - start;
+  });
+  server.setAutoCork(autoCork);
+  server.start();
+
+  std::thread client([&] {
+    std::vector<int> fds;
+    for (int i = 0; i < opt.connections; ++i) {
+      fds.push_back(connectTo(port));
+    }
+    while (numSubscribers < opt.connections) {
+      ::usleep(1000);
+    }
+    std::vector<char> data(opt.size * opt.burst);
+    auto round = [&] {
+      if (::write(fds[0], "r", 1) != 1) {
+        perror("write");
+        exit(1);
+      }
+      for (int fd : fds) {
+        size_t received = 0;
+        while (received < data.size()) {
+          ssize_t n = ::read(fd, data.data(), data.size() - received);
+          if (n <= 0) {
+            perror("read");
+            exit(1);
+          }
+          received += n;
+        }
+      }
+    };
+
+    // 预热，让各个缓冲区和内存池达到稳定状态
+    round();
+    loop.runInLoop([&] { broadcastNs = 0; });
+    const uint64_t allocations = g_allocations.load();
+    const uint64_t bytes = g_allocatedBytes.load();
+    const int64_t start = nowNs();
+    for (int r = 0; r < opt.rounds; ++r) {
+      round();
+    }
+    const int64_t elapsed = nowNs() - start;
+    const double deliveries =
+        static_cast<double>(opt.rounds) * opt.burst * opt.connections;
+    const double allocsPerMsg =
+        (g_allocations.load() - allocations) / deliveries;
+    const double bytesPerMsg = (g_allocatedBytes.load() - bytes) / deliveries;
+    // 本线程的局部变量在lambda执行前就失效了，按值捕获；broadcastNs只能在loop线程读
+    loop.runInLoop([&loop, &broadcastNs, shared, autoCork, deliveries, elapsed,
+                    allocsPerMsg, bytesPerMsg] {
+      printf("%-6s %-8s %9.0f msg/s  broadcast %6.1f ns/msg  %5.2f allocs/msg  "
+             "%8.1f bytes/msg\n",
+             shared ? "shared" : "copy", autoCork ? "autocork" : "direct",
+             deliveries * 1e9 / elapsed, broadcastNs / deliveries,
+             allocsPerMsg, bytesPerMsg);
+      loop.quit();
+    });
+    for (int fd : fds) {
+      ::close(fd);
+    }
+  });
+  loop.loop();
+  client.join();
+  subscribers.clear();
+}
+
+int main(int argc, char *argv[]) {
+  Options opt;
+  opt.connections = argc > 1 ? atoi(argv[1]) : 500;
+  opt.rounds = argc > 2 ? atoi(argv[2]) : 20;
+  opt.burst = argc > 3 ? atoi(argv[3]) : 16;
+  opt.size = argc > 4 ? atoi(argv[4]) : 4096;
+  Logger::setLogLevel(Logger::WARN);
+
+  printf("%d connections, %d messages of %zu bytes per round\n",
+         opt.connections, opt.burst, opt.size);
+  uint16_t port = 9981;
+  for (bool autoCork : {false, true}) {
+    bench(false, autoCork, port++, opt);
+    bench(true, autoCork, port++, opt);
+  }
+}
@@ -0,0 +1,112 @@
+// 各个LoopSelector在长短连接混合时的负载分布
+// 客户端依次建立connections个连接，每个连接先完成一次回显；每loops个连接中第一个是长连接，
+// 保持打开并在之后每建立一个连接时回显一次，其余是短连接，回显后立即关闭。
+// 轮询时长连接全部落在同一个loop上，按连接数或忙碌时间选择的策略能把它们分散开；
+// 客户端都来自127.0.0.1，peerHash会把所有连接放在同一个loop
+// usage: net_loopselector_bench [connections] [loops]
+#include "src/net/EventLoop.h"
+#include "src/net/LoopSelector.h"
+#include "src/net/TcpServer.h"
+#include "src/logger/Logging.h"
+#include "src/net/test/BenchUtil.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace mymuduo;
+
+static void roundTrip(int fd) {
+  char c = 'p';
+  if (::write(fd, &c, 1) != 1 || ::read(fd, &c, 1) != 1) {
+    perror("roundTrip");
+    exit(1);
+  }
+}
+
+static void bench(const char *name, std::unique_ptr<LoopSelector> selector,
+                  uint16_t port, int connections, int numLoops) {
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(port), "LoopSelectorBench");
+  server.setConnectionCallback([](const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+      conn->setTcpNoDelay(true);
+    }
+  });
+  server.setMessageCallback(
+      [](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+        conn->send(buf);
+      });
+  server.setThreadNum(numLoops);
+  if (selector) {
+    server.setLoopSelector(std::move(selector));
+  }
+  server.start();
+  std::vector<EventLoop *> loops = server.threadPool()->getAllLoops();
+
+  std::thread client([&] {
+    std::vector<int> longLived;
+    for (int i = 0; i < connections; ++i) {
+      int fd = connectTo(port);
+      roundTrip(fd);
+      if (i % numLoops == 0) {
+        longLived.push_back(fd);
+      } else {
+        ::close(fd);
+      }
+      for (int f : longLived) {
+        roundTrip(f);
+      }
+    }
+    // 等待短连接全部析构，只剩长连接
+    for (int i = 0; i < 1000; ++i) {
+      int total = 0;
+      for (EventLoop *l : loops) {
+        total += l->numConnections();
+      }
+      if (total == static_cast<int>(longLived.size())) {
+        break;
+      }
+      ::usleep(1000);
+    }
+
+    int maxConns = 0;
+    std::string counts;
+    for (EventLoop *l : loops) {
+      int n = l->numConnections();
+      maxConns = std::max(maxConns, n);
+      counts += " " + std::to_string(n);
+    }
+    printf("%-12s long connections per loop:%s  max/avg %.2f\n", name,
+           counts.c_str(),
+           static_cast<double>(maxConns) * loops.size() / longLived.size());
+    for (int f : longLived) {
+      ::close(f);
+    }
+    loop.queueInLoop([&loop] { loop.quit(); });
+  });
+  loop.loop();
+  client.join();
+}
+
+int main(int argc, char *argv[]) {
+  int connections = argc > 1 ? atoi(argv[1]) : 400;
+  int numLoops = argc > 2 ? atoi(argv[2]) : 4;
+  Logger::setLogLevel(Logger::WARN);
+
+  uint16_t port = 9981;
+  bench("roundrobin", nullptr, port++, connections, numLoops);
+  bench("leastconns", LoopSelector::newLeastConnections(), port++, connections,
+        numLoops);
+  bench("leastbusy", LoopSelector::newLeastBusy(1), port++, connections,
+        numLoops);
+  bench("twochoices", LoopSelector::newPowerOfTwoChoices(), port++,
+        connections, numLoops);
+  bench("peerhash", LoopSelector::newPeerHash(), port++, connections,
+        numLoops);
+}
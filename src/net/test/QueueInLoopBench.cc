@@ -0,0 +1,167 @@
+// 比较EventLoop::pendingFunctors_的两种实现：
+//   mutex   : std::mutex + std::vector<Functor>，消费时swap整个vector(原实现)
+//   lockfree: MpscQueue<Functor>(现实现)
+// 以及多个线程通过EventLoop::queueInLoop向同一个loop投递任务的端到端吞吐。
+// queueInLoop window=N时每个生产者最多有N个任务未执行(loop跟得上的稳定状态)，
+// 不限制时生产者远快于loop，队列会积压。
+// allocs/task是每个任务的堆分配次数，测试用的任务都放得进std::function的内部缓冲区，
+// 分配只来自队列本身
+// usage: net_queueinloop_bench [producers] [tasksPerProducer]
+#include "src/base/MpscQueue.h"
+#include "src/net/EventLoop.h"
+#include "src/net/EventLoopThread.h"
+#include "src/logger/Logging.h"
+#include "src/net/test/BenchUtil.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+using namespace mymuduo;
+using Functor = std::function<void()>;
+
+static std::atomic<uint64_t> g_allocations(0);
+
+void *operator new(size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  void *p = malloc(size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+class MutexQueue {
+public:
+  void push(Functor cb) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    functors_.emplace_back(std::move(cb));
+  }
+  template <typename F> size_t consume(F &&f) {
+    std::vector<Functor> functors;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      functors.swap(functors_);
+    }
+    for (Functor &functor : functors) {
+      f(functor);
+    }
+    return functors.size();
+  }
+
+private:
+  std::mutex mutex_;
+  std::vector<Functor> functors_;
+};
+
+template <typename Queue>
+void benchQueue(const char *name, int producers, int perProducer) {
+  Queue queue;
+  const int64_t total = static_cast<int64_t>(producers) * perProducer;
+  std::vector<int64_t> latencies;
+  latencies.reserve(total);
+
+  const uint64_t allocations = g_allocations.load();
+  int64_t start = nowNs();
+  std::thread consumer([&] {
+    int64_t consumed = 0;
+    while (consumed < total) {
+      size_t n = queue.consume([](Functor &f) { f(); });
+      if (n == 0) {
+        std::this_thread::yield();
+      }
+      consumed += n;
+    }
+  });
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < perProducer; ++i) {
+        int64_t posted = nowNs();
+        std::vector<int64_t> *out = &latencies;
+        // 只在消费者线程里写latencies
+        queue.push([posted, out] { out->push_back(nowNs() - posted); });
+      }
+    });
+  }
+  for (std::thread &t : threads) {
+    t.join();
+  }
+  consumer.join();
+  int64_t elapsed = nowNs() - start;
+  const uint64_t allocated = g_allocations.load() - allocations;
+
+  std::sort(latencies.begin(), latencies.end());
+  printf("%-9s producers=%d tasks=%lld  %8.2f Mtasks/s  %.3f allocs/task  "
+         "latency p50=%lldns p99=%lldns max=%lldns\n",
+         name, producers, static_cast<long long>(total),
+         static_cast<double>(total) * 1000 / elapsed,
+         static_cast<double>(allocated) / total,
+         static_cast<long long>(latencies[latencies.size() / 2]),
+         static_cast<long long>(latencies[latencies.size() * 99 / 100]),
+         static_cast<long long>(latencies.back()));
+}
+
+void benchEventLoop(int producers, int perProducer, int window) {
+  EventLoopThread loopThread;
+  EventLoop *loop = loopThread.startLoop();
+  const int64_t total = static_cast<int64_t>(producers) * perProducer;
+  std::atomic<int64_t> done(0);
+  std::vector<std::atomic<int64_t>> doneByProducer(producers);
+  for (auto &d : doneByProducer) {
+    d = 0;
+  }
+
+  const uint64_t allocations = g_allocations.load();
+  int64_t start = nowNs();
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&, p] {
+      std::atomic<int64_t> *mine = &doneByProducer[p];
+      for (int i = 0; i < perProducer; ++i) {
+        while (window > 0 && i - mine->load(std::memory_order_relaxed) >= window) {
+          std::this_thread::yield();
+        }
+        loop->queueInLoop([&done, mine] {
+          mine->fetch_add(1, std::memory_order_relaxed);
+          done.fetch_add(1, std::memory_order_relaxed);
+        });
+      }
+    });
+  }
+  for (std::thread &t : threads) {
+    t.join();
+  }
+  while (done.load() < total) {
+    std::this_thread::yield();
+  }
+  int64_t elapsed = nowNs() - start;
+  const uint64_t allocated = g_allocations.load() - allocations;
+  printf("queueInLoop window=%-3d producers=%d tasks=%lld  %8.2f Mtasks/s  "
+         "%.3f allocs/task  wakeups issued=%llu skipped=%llu\n",
+         window, producers, static_cast<long long>(total),
+         static_cast<double>(total) * 1000 / elapsed,
+         static_cast<double>(allocated) / total,
+         static_cast<unsigned long long>(loop->wakeupsIssued()),
+         static_cast<unsigned long long>(loop->wakeupsSkipped()));
+}
+
+int main(int argc, char *argv[]) {
+  int producers = argc > 1 ? atoi(argv[1]) : 4;
+  int perProducer = argc > 2 ? atoi(argv[2]) : 200000;
+  Logger::setLogLevel(Logger::WARN);
+
+  benchQueue<MutexQueue>("mutex", producers, perProducer);
+  benchQueue<MpscQueue<Functor>>("lockfree", producers, perProducer);
+  benchEventLoop(producers, perProducer, 0);
+  benchEventLoop(producers, perProducer, 64);
+}
@@ -0,0 +1,159 @@
+// TcpConnection::send各个重载每条响应的堆分配和吞吐
+// 客户端发1字节请求，读回size字节的响应；服务器每次新建一条响应，用以下方式发送：
+//   ptr     : send(data, len)
+//   string& : send(const std::string &)
+//   string&&: send(std::move(string))
+//   Buffer* : send(&buffer)
+//   Buffer&&: send(std::move(buffer))
+// inloop在loop线程中调用send，cross在另一个loop线程中调用send。
+// 消息每多拷贝一份就要多分配一块size字节的内存，bytes/resp减去size就是多拷贝的字节数
+// usage: net_send_bench [responses] [size]
+#include "src/net/EventLoop.h"
+#include "src/net/EventLoopThread.h"
+#include "src/net/TcpServer.h"
+#include "src/logger/Logging.h"
+#include "src/net/test/BenchUtil.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace mymuduo;
+
+extern "C" void *__libc_malloc(size_t size);
+
+static std::atomic<uint64_t> g_allocations(0);
+static std::atomic<uint64_t> g_allocatedBytes(0);
+
+// operator new和Buffer的内存最终都经过malloc
+extern "C" void *malloc(size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+  return __libc_malloc(size);
+}
+
+enum Mode { kPtr, kStringRef, kStringMove, kBufferPtr, kBufferMove, kNumModes };
+static const char *const kModeNames[kNumModes] = {"ptr", "string&", "string&&",
+                                                  "Buffer*", "Buffer&&"};
+
+static std::atomic<int> g_mode(kPtr);
+static std::atomic<bool> g_cross(false);
+static size_t g_size = 4096;
+static std::vector<char> g_payload;
+
+static void sendResponse(const TcpConnectionPtr &conn) {
+  switch (g_mode.load(std::memory_order_relaxed)) {
+  case kPtr:
+    conn->send(g_payload.data(), g_size);
+    break;
+  case kStringRef: {
+    std::string response(g_payload.data(), g_size);
+    conn->send(response);
+    break;
+  }
+  case kStringMove: {
+    std::string response(g_payload.data(), g_size);
+    conn->send(std::move(response));
+    break;
+  }
+  case kBufferPtr: {
+    Buffer response(g_size);
+    response.append(g_payload.data(), g_size);
+    conn->send(&response);
+    break;
+  }
+  case kBufferMove: {
+    Buffer response(g_size);
+    response.append(g_payload.data(), g_size);
+    conn->send(std::move(response));
+    break;
+  }
+  }
+}
+
+// 阻塞的客户端：每个模式发responses次请求，每次读完整条响应
+static void runClient(EventLoop *loop, int responses) {
+  int fd = connectTo(9981);
+  std::vector<char> response(g_size);
+  auto roundTrip = [&] {
+    char request = 'r';
+    if (::write(fd, &request, 1) != 1) {
+      perror("write");
+      exit(1);
+    }
+    size_t received = 0;
+    while (received < g_size) {
+      ssize_t n = ::read(fd, response.data(), g_size - received);
+      if (n <= 0) {
+        perror("read");
+        exit(1);
+      }
+      received += n;
+    }
+  };
+
+  for (int cross = 0; cross < 2; ++cross) {
+    g_cross = cross != 0;
+    for (int mode = 0; mode < kNumModes; ++mode) {
+      g_mode = mode;
+      // 预热，让BufferPool和各个缓冲区达到稳定状态
+      for (int i = 0; i < 1000; ++i) {
+        roundTrip();
+      }
+      uint64_t allocations = g_allocations.load();
+      uint64_t bytes = g_allocatedBytes.load();
+      int64_t start = nowNs();
+      for (int i = 0; i < responses; ++i) {
+        roundTrip();
+      }
+      int64_t elapsed = nowNs() - start;
+      printf("%-6s %-9s %8.0f resp/s  %5.2f allocs/resp  %9.1f bytes/resp\n",
+             cross ? "cross" : "inloop", kModeNames[mode],
+             static_cast<double>(responses) * 1e9 / elapsed,
+             static_cast<double>(g_allocations.load() - allocations) /
+                 responses,
+             static_cast<double>(g_allocatedBytes.load() - bytes) / responses);
+    }
+  }
+  ::close(fd);
+  loop->quit();
+}
+
+int main(int argc, char *argv[]) {
+  int responses = argc > 1 ? atoi(argv[1]) : 100000;
+  g_size = argc > 2 ? atoi(argv[2]) : 4096;
+  g_payload.assign(g_size, 'x');
+  Logger::setLogLevel(Logger::WARN);
+
+  EventLoopThread workerThread;
+  EventLoop *worker = workerThread.startLoop();
+
+  EventLoop loop;
+  InetAddress listenAddr(9981);
+  TcpServer server(&loop, listenAddr, "SendBench");
+  server.setConnectionCallback([](const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+      conn->setTcpNoDelay(true);
+    }
+  });
+  server.setMessageCallback(
+      [worker](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+        buf->retrieveAll();
+        if (g_cross.load(std::memory_order_relaxed)) {
+          worker->runInLoop([conn] { sendResponse(conn); });
+        } else {
+          sendResponse(conn);
+        }
+      });
+  server.start();
+
+  printf("response size: %zu\n", g_size);
+  std::thread client(runClient, &loop, responses);
+  loop.loop();
+  client.join();
+}
@@ -0,0 +1,110 @@
+// 在loop线程中测试两种TimerQueue添加/取消定时器的吞吐，以及每次操作的堆分配次数
+//   sorted: SortedTimerQueue(std::set)
+//   wheel : TimingWheel
+// 先添加liveTimers个不会到期的定时器，再测：
+//   add   : 继续添加ops个
+//   cancel: 取消ops个
+//   churn : 取消一个再添加一个(如HTTP每条消息重设超时定时器)
+// usage: net_timer_bench [liveTimers] [ops]
+#include "src/net/EventLoop.h"
+#include "src/logger/Logging.h"
+#include "src/net/test/BenchUtil.h"
+
+#include <atomic>
+#include <new>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace mymuduo;
+
+static std::atomic<uint64_t> g_allocations(0);
+
+void *operator new(size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  void *p = malloc(size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+static void onTimer() {}
+
+class Bench {
+public:
+  Bench(const char *name, int64_t ops) : name_(name), ops_(ops) {}
+
+  void start() {
+    allocations_ = g_allocations.load();
+    start_ = nowNs();
+  }
+
+  void stop(const char *what) {
+    int64_t elapsed = nowNs() - start_;
+    uint64_t allocations = g_allocations.load() - allocations_;
+    printf("%-6s %-6s %8.2f Mops/s  %6.1f ns/op  %.2f allocs/op\n", name_, what,
+           static_cast<double>(ops_) * 1000 / elapsed,
+           static_cast<double>(elapsed) / ops_,
+           static_cast<double>(allocations) / ops_);
+  }
+
+private:
+  const char *name_;
+  int64_t ops_;
+  uint64_t allocations_;
+  int64_t start_;
+};
+
+void benchTimerQueue(const char *name, bool timingWheel, int liveTimers,
+                     int ops) {
+  EventLoop loop;
+  loop.setTimingWheel(timingWheel);
+  std::mt19937 rng(42);
+  // 60~120秒后到期，测试期间不会触发
+  auto randomTime = [&rng] {
+    return addTime(Timestamp::now(), 60 + rng() % 60000 / 1000.0);
+  };
+
+  std::vector<TimerId> ids;
+  ids.reserve(liveTimers + ops);
+  for (int i = 0; i < liveTimers; ++i) {
+    ids.push_back(loop.runAt(randomTime(), onTimer));
+  }
+
+  Bench bench(name, ops);
+  bench.start();
+  for (int i = 0; i < ops; ++i) {
+    ids.push_back(loop.runAt(randomTime(), onTimer));
+  }
+  bench.stop("add");
+
+  bench.start();
+  for (int i = 0; i < ops; ++i) {
+    loop.cancel(ids.back());
+    ids.pop_back();
+  }
+  bench.stop("cancel");
+
+  bench.start();
+  for (int i = 0; i < ops; ++i) {
+    TimerId &id = ids[rng() % ids.size()];
+    loop.cancel(id);
+    id = loop.runAt(randomTime(), onTimer);
+  }
+  bench.stop("churn");
+}
+
+int main(int argc, char *argv[]) {
+  int liveTimers = argc > 1 ? atoi(argv[1]) : 1000000;
+  int ops = argc > 2 ? atoi(argv[2]) : 1000000;
+  Logger::setLogLevel(Logger::WARN);
+
+  printf("live timers: %d\n", liveTimers);
+  benchTimerQueue("sorted", false, liveTimers, ops);
+  benchTimerQueue("wheel", true, liveTimers, ops);
+}